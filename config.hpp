@@ -7,44 +7,50 @@
 
 #include <string>
 #include <map>
+#include <cstdint>
 using namespace std;
 
 namespace Config {
     constexpr int DISPLAY_WIDTH = 320;
     constexpr int DISPLAY_HEIGHT = 200;
     constexpr  int TEXTURE_SIZE = 32;
+    constexpr int LIGHTMAP_SUBDIVISION = 4;
+    // tile layers interleaved per cell (true) or one array per layer (false)
+    constexpr bool INTERLEAVED_TILES = true;
+    // big enough for every tileset the shipped maps use, uint16_t for larger ones
+    using TileIdType = uint8_t;
+    // streamed maps: 32x32 tile chunks, a ring of 8x8 chunks around the player, evicted chunks kept for reuse.
+    // Bounds the tiles the raycaster works on, not the memory of the map.
+    constexpr int CHUNK_SHIFT = 5;
+    constexpr int STREAMING_RING_SHIFT = 3;
+    constexpr size_t STREAMING_CACHE_CHUNKS = 64;
+    // rays jump over open space from tiles at least this far from any wall, shorter jumps cost more than they save
+    constexpr int RAY_SKIP_DISTANCE = 8;
+    // rays give up after this many tiles
+    constexpr double MAX_RAY_DISTANCE = 1024.0;
     const string WINDOW_TITLE = string("Renegade Engine");
     constexpr double UPDATE_DELAY = 0.016;
 
     constexpr double PLAYER_ROTATION_SPEED = 2.0;
     constexpr double PLAYER_MOVEMENT_SPEED = 2.0;
     constexpr double PLAYER_RUN_SPEED = 5.66;
+    // chasers within this many tiles of the player share one flow field toward them, see FlowField
+    constexpr int CHASE_RANGE = 64;
+    // threads searching paths for entities, see PathService
+    constexpr int PATH_WORKERS = 2;
+    // tiles the incremental search of a chaser keeps at most, see AStar::Replanner. It runs on the update
+    // thread with the grid locked, paths it can't find with that few tiles are left to PathService.
+    constexpr size_t REPLAN_STATES = 1024;
 
     constexpr int WINDOW_WIDTH = 1280;
     constexpr int WINDOW_HEIGHT = 800;
 
-    map<string, string> TEXTURE_MAP = {
-            { "assets/hand.png", "hand" },
-            { "assets/textures.png", "textures" },
-            { "assets/dungeon.png", "dungeon" },
-            { "assets/backdrop.png", "background" },
-            { "assets/sprites/mask.png",  "mask" },
-            { "assets/sprites/spear-head.png", "spearhead" },
-            { "assets/sprites/statue-1.png", "statue" },
-            { "assets/sprites/candles.png", "candles" },
-            { "assets/sprites/cage.png", "cage" },
-            { "assets/sprites/skull-1.png", "skull" },
-            { "assets/sprites/hook.png", "hook" },
-            { "assets/sprites/barell.png", "barell" },
-            { "assets/sprites/mask.png", "mask" },
-            { "assets/sprites/tree-1.png", "tree-1" },
-            { "assets/sprites/tree-2.png", "tree-2" },
-            { "assets/sprites/bed.png", "bed" },
-            { "assets/sprites/stool.png", "stool" },
-            { "assets/sprites/infusion.png", "infusion" },
-            { "assets/sprites/infusion2.png", "infusion-2" },
-            { "assets/sprites/wheelchair.png", "wheelchair" },
-    };
+    // textures to load at startup, see AssetManifest
+    const string TEXTURE_MANIFEST = string("assets/textures.manifest");
+    // decoded textures, so that later starts skip decoding the images
+    const string TEXTURE_CACHE_DIRECTORY = string(".texture-cache");
+    // level textures (sprites) that stay loaded after the level using them is left
+    constexpr size_t LEVEL_TEXTURE_BUDGET = 16 * 1024 * 1024;
 
     struct vec2i {
         int x;
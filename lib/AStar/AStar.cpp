@@ -2,8 +2,6 @@
 #include <algorithm>
 #include <math.h>
 
-using namespace std::placeholders;
-
 bool AStar::Vec2i::operator == (const Vec2i& coordinates_)
 {
     return (x == coordinates_.x && y == coordinates_.y);
@@ -14,22 +12,16 @@ AStar::Vec2i operator + (const AStar::Vec2i& left_, const AStar::Vec2i& right_)
     return{ left_.x + right_.x, left_.y + right_.y };
 }
 
-AStar::Node::Node(Vec2i coordinates_, Node *parent_)
-{
-    parent = parent_;
-    coordinates = coordinates_;
-    G = H = 0;
-}
-
-AStar::uint AStar::Node::getScore()
-{
-    return G + H;
-}
-
 AStar::Generator::Generator()
 {
     setDiagonalMovement(false);
     setHeuristic(&Heuristic::manhattan);
+    worldSize = { 0, 0 };
+    jumpPointSearch = false;
+    jumpRowWords = 0;
+    jumpColumnWords = 0;
+    collisionRowWords = 0;
+    search = 0;
     direction = {
         { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 },
         { -1, -1 }, { 1, 1 }, { -1, 1 }, { 1, -1 }
@@ -39,6 +31,8 @@ AStar::Generator::Generator()
 void AStar::Generator::setWorldSize(Vec2i worldSize_)
 {
     worldSize = worldSize_;
+    collisionRowWords = (std::max(worldSize.x, 0) + 63) / 64;
+    collisions.assign((size_t)collisionRowWords * std::max(worldSize.y, 0), 0);
 }
 
 void AStar::Generator::setDiagonalMovement(bool enable_)
@@ -46,117 +40,461 @@ void AStar::Generator::setDiagonalMovement(bool enable_)
     directions = (enable_ ? 8 : 4);
 }
 
+void AStar::Generator::setJumpPointSearch(bool enable_)
+{
+    jumpPointSearch = enable_;
+}
+
 void AStar::Generator::setHeuristic(HeuristicFunction heuristic_)
 {
-    heuristic = std::bind(heuristic_, _1, _2);
+    heuristic = heuristic_;
 }
 
 void AStar::Generator::addCollision(Vec2i coordinates_)
 {
-    walls.push_back(coordinates_);
+    if (coordinates_.x < 0 || coordinates_.x >= worldSize.x ||
+        coordinates_.y < 0 || coordinates_.y >= worldSize.y) {
+        return;
+    }
+    collisions[coordinates_.y * collisionRowWords + (coordinates_.x >> 6)] |= 1ull << (coordinates_.x & 63);
 }
 
 void AStar::Generator::removeCollision(Vec2i coordinates_)
 {
-    auto it = std::find(walls.begin(), walls.end(), coordinates_);
-    if (it != walls.end()) {
-        walls.erase(it);
+    if (coordinates_.x < 0 || coordinates_.x >= worldSize.x ||
+        coordinates_.y < 0 || coordinates_.y >= worldSize.y) {
+        return;
     }
+    collisions[coordinates_.y * collisionRowWords + (coordinates_.x >> 6)] &= ~(1ull << (coordinates_.x & 63));
 }
 
 void AStar::Generator::clearCollisions()
 {
-    walls.clear();
+    std::fill(collisions.begin(), collisions.end(), 0);
+}
+
+void AStar::Generator::setCollisionGrid(CollisionGrid grid_)
+{
+    collisionGrid = grid_;
+}
+
+void AStar::Generator::prepareSearch()
+{
+    size_t tiles = (size_t)std::max(worldSize.x, 0) * (size_t)std::max(worldSize.y, 0);
+    if (stamp.size() != tiles) {
+        gScore.assign(tiles, 0);
+        fScore.assign(tiles, 0);
+        parent.assign(tiles, -1);
+        heapPosition.assign(tiles, -1);
+        stamp.assign(tiles, 0);
+        closed.assign((tiles + 63) / 64, 0);
+        search = 0;
+    }
+    if (++search == 0) {
+        // stamps wrapped around, none of them may look current
+        std::fill(stamp.begin(), stamp.end(), 0);
+        search = 1;
+    }
+    openHeap.clear();
+    touched.clear();
+}
+
+// Lower f first, ties go to the tile closer to the target (higher G)
+uint64_t AStar::Generator::heapKey(int tile_) const
+{
+    return ((uint64_t)fScore[tile_] << 32) | (uint32_t)~gScore[tile_];
+}
+
+void AStar::Generator::siftUp(int position_)
+{
+    OpenTile open = openHeap[position_];
+    while (position_ > 0) {
+        int up = (position_ - 1) / 2;
+        if (openHeap[up].key <= open.key) {
+            break;
+        }
+        openHeap[position_] = openHeap[up];
+        heapPosition[openHeap[position_].tile] = position_;
+        position_ = up;
+    }
+    openHeap[position_] = open;
+    heapPosition[open.tile] = position_;
+}
+
+void AStar::Generator::siftDown(int position_)
+{
+    OpenTile open = openHeap[position_];
+    int count = (int)openHeap.size();
+    while (true) {
+        int child = position_ * 2 + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && openHeap[child + 1].key < openHeap[child].key) {
+            child++;
+        }
+        if (open.key <= openHeap[child].key) {
+            break;
+        }
+        openHeap[position_] = openHeap[child];
+        heapPosition[openHeap[position_].tile] = position_;
+        position_ = child;
+    }
+    openHeap[position_] = open;
+    heapPosition[open.tile] = position_;
+}
+
+void AStar::Generator::pushOpen(int tile_)
+{
+    openHeap.push_back({ heapKey(tile_), tile_ });
+    siftUp((int)openHeap.size() - 1);
+}
+
+int AStar::Generator::popOpen()
+{
+    int tile = openHeap.front().tile;
+    heapPosition[tile] = -1;
+    OpenTile last = openHeap.back();
+    openHeap.pop_back();
+    if (!openHeap.empty()) {
+        openHeap[0] = last;
+        siftDown(0);
+    }
+    return tile;
+}
+
+// Opens a tile or lowers its cost when it is reached for less than before
+void AStar::Generator::reach(int tile_, int from_, uint cost_, Vec2i coordinates_, Vec2i target_)
+{
+    if ((closed[tile_ >> 6] >> (tile_ & 63)) & 1) {
+        return;
+    }
+    if (stamp[tile_] != search) {
+        stamp[tile_] = search;
+        gScore[tile_] = cost_;
+        fScore[tile_] = cost_ + heuristic(coordinates_, target_);
+        parent[tile_] = from_;
+        touched.push_back(tile_);
+        pushOpen(tile_);
+    }
+    else if (cost_ < gScore[tile_]) {
+        fScore[tile_] -= gScore[tile_] - cost_;
+        gScore[tile_] = cost_;
+        parent[tile_] = from_;
+        openHeap[heapPosition[tile_]].key = heapKey(tile_);
+        siftUp(heapPosition[tile_]);
+    }
+}
+
+void AStar::Generator::expandNeighbors(int current_, Vec2i target_)
+{
+    int width = worldSize.x;
+    Vec2i coordinates = { current_ % width, current_ / width };
+    for (uint i = 0; i < directions; ++i) {
+        Vec2i newCoordinates(coordinates + direction[i]);
+        if (detectCollision(newCoordinates)) {
+            continue;
+        }
+        uint totalCost = gScore[current_] + ((i < 4) ? 10 : 14);
+        reach(newCoordinates.y * width + newCoordinates.x, current_, totalCost, newCoordinates, target_);
+    }
 }
 
 AStar::CoordinateList AStar::Generator::findPath(Vec2i source_, Vec2i target_)
 {
-    Node *current = nullptr;
-    NodeSet openSet, closedSet;
-    openSet.reserve(100);
-    closedSet.reserve(100);
-    openSet.push_back(new Node(source_));
-
-    while (!openSet.empty()) {
-        auto current_it = openSet.begin();
-        current = *current_it;
-
-        for (auto it = openSet.begin(); it != openSet.end(); it++) {
-            auto node = *it;
-            if (node->getScore() <= current->getScore()) {
-                current = node;
-                current_it = it;
-            }
+    CoordinateList path;
+    if (source_.x < 0 || source_.x >= worldSize.x || source_.y < 0 || source_.y >= worldSize.y) {
+        path.push_back(source_);
+        return path;
+    }
+
+    prepareSearch();
+    int width = worldSize.x;
+    int source = source_.y * width + source_.x;
+    bool targetInside = target_.x >= 0 && target_.x < worldSize.x && target_.y >= 0 && target_.y < worldSize.y;
+    int target = targetInside ? target_.y * width + target_.x : -1;
+    bool jumping = jumpPointSearch && directions == 8;
+    if (jumping) {
+        prepareJumpGrids();
+    }
+
+    stamp[source] = search;
+    gScore[source] = 0;
+    fScore[source] = heuristic(source_, target_);
+    parent[source] = -1;
+    touched.push_back(source);
+    pushOpen(source);
+
+    int closest = source;
+    while (!openHeap.empty()) {
+        int current = popOpen();
+        if (fScore[current] - gScore[current] < fScore[closest] - gScore[closest]) {
+            closest = current;
+        }
+        if (current == target) {
+            closest = current;
+            break;
         }
+        closed[current >> 6] |= 1ull << (current & 63);
+
+        if (jumping) {
+            expandJumpPoints(current, target_);
+        }
+        else {
+            expandNeighbors(current, target_);
+        }
+    }
 
-        if (current->coordinates == target_) {
+    // jump points are joined by straight or diagonal runs, the tiles in between are filled in
+    for (int tile = closest; tile != -1; tile = parent[tile]) {
+        Vec2i coordinates = { tile % width, tile / width };
+        path.push_back(coordinates);
+        if (parent[tile] == -1) {
             break;
         }
+        Vec2i to = { parent[tile] % width, parent[tile] / width };
+        Vec2i step = { (to.x > coordinates.x) - (to.x < coordinates.x), (to.y > coordinates.y) - (to.y < coordinates.y) };
+        for (coordinates = coordinates + step; !(coordinates == to); coordinates = coordinates + step) {
+            path.push_back(coordinates);
+        }
+    }
 
-        closedSet.push_back(current);
-        openSet.erase(current_it);
+    for (int tile : touched) {
+        closed[tile >> 6] &= ~(1ull << (tile & 63));
+    }
 
-        for (uint i = 0; i < directions; ++i) {
-            Vec2i newCoordinates(current->coordinates + direction[i]);
-            if (detectCollision(newCoordinates) ||
-                findNodeOnList(closedSet, newCoordinates)) {
-                continue;
-            }
+    return path;
+}
 
-            uint totalCost = current->G + ((i < 4) ? 10 : 14);
+// Swaps bit j of word i with bit i of word j, Hacker's Delight 7-3 for 64 bits
+static void transpose64(uint64_t block_[64])
+{
+    uint64_t mask = 0x00000000FFFFFFFFull;
+    for (int width = 32; width != 0; width >>= 1, mask ^= mask << width) {
+        for (int i = 0; i < 64; i = ((i | width) + 1) & ~width) {
+            uint64_t swap = ((block_[i] >> width) ^ block_[i | width]) & mask;
+            block_[i] ^= swap << width;
+            block_[i | width] ^= swap;
+        }
+    }
+}
+
+// Both collision grids merged by row and by column, with the tiles past the end of a line set, so that
+// straight jumps test 64 tiles at a time in either orientation. Rebuilt per search as the referenced grid
+// may change between searches.
+void AStar::Generator::prepareJumpGrids()
+{
+    int width = worldSize.x;
+    int height = worldSize.y;
+    jumpRowWords = (width + 63) / 64;
+    jumpColumnWords = (height + 63) / 64;
+    jumpRows.assign(static_cast<size_t>(jumpRowWords) * height, 0);
+    jumpColumns.assign(static_cast<size_t>(jumpColumnWords) * width, 0);
+
+    uint64_t rowEnd = (width & 63) ? ~0ull << (width & 63) : 0;
+    for (int y = 0; y < height; ++y) {
+        uint64_t *row = &jumpRows[static_cast<size_t>(y) * jumpRowWords];
+        for (int word = 0; word < jumpRowWords; ++word) {
+            uint64_t bits = collisions[static_cast<size_t>(y) * collisionRowWords + word];
+            if (collisionGrid.words != nullptr) {
+                bits |= collisionGrid.words[static_cast<size_t>(y) * collisionGrid.rowWords + word];
+            }
+            row[word] = bits;
+        }
+        row[jumpRowWords - 1] |= rowEnd;
+    }
 
-            Node *successor = findNodeOnList(openSet, newCoordinates);
-            if (successor == nullptr) {
-                successor = new Node(newCoordinates, current);
-                successor->G = totalCost;
-                successor->H = heuristic(successor->coordinates, target_);
-                openSet.push_back(successor);
+    uint64_t block[64];
+    for (int blockY = 0; blockY < jumpColumnWords; ++blockY) {
+        for (int blockX = 0; blockX < jumpRowWords; ++blockX) {
+            for (int i = 0; i < 64; ++i) {
+                int y = blockY * 64 + i;
+                block[i] = y < height ? jumpRows[static_cast<size_t>(y) * jumpRowWords + blockX] : ~0ull;
             }
-            else if (totalCost < successor->G) {
-                successor->parent = current;
-                successor->G = totalCost;
+            transpose64(block);
+            for (int i = 0; i < 64 && blockX * 64 + i < width; ++i) {
+                jumpColumns[static_cast<size_t>(blockX * 64 + i) * jumpColumnWords + blockY] = block[i];
             }
         }
     }
+}
 
-    CoordinateList path;
-    while (current != nullptr) {
-        path.push_back(current->coordinates);
-        current = current->parent;
+// Tiles [start_, start_ + 64) of a line as bits, everything outside the grid is blocked
+uint64_t AStar::Generator::lineBits(const std::vector<uint64_t>& grid_, int lineWords_, int lines_, int line_, int start_)
+{
+    if (line_ < 0 || line_ >= lines_) {
+        return ~0ull;
+    }
+    int word = start_ >= 0 ? start_ / 64 : -((63 - start_) / 64);
+    int shift = start_ - word * 64;
+    const uint64_t *words = &grid_[static_cast<size_t>(line_) * lineWords_];
+    uint64_t low = (word >= 0 && word < lineWords_) ? words[word] : ~0ull;
+    if (shift == 0) {
+        return low;
     }
+    uint64_t high = (word + 1 >= 0 && word + 1 < lineWords_) ? words[word + 1] : ~0ull;
+    return (low >> shift) | (high << (64 - shift));
+}
 
-    releaseNodes(openSet);
-    releaseNodes(closedSet);
+bool AStar::Generator::isBlocked(int x_, int y_)
+{
+    if (x_ < 0 || x_ >= worldSize.x || y_ < 0 || y_ >= worldSize.y) {
+        return true;
+    }
+    return (jumpRows[static_cast<size_t>(y_) * jumpRowWords + (x_ >> 6)] >> (x_ & 63)) & 1;
+}
 
-    return path;
+// Straight jump along a row or a column (a line of the row or column grid) from position_ in direction
+// step_. Stops before a blocked tile, on the target and on tiles with a forced neighbor: one next to the
+// line is blocked and the one after it is free. Returns the position of the jump point or -1.
+int AStar::Generator::jumpStraight(const std::vector<uint64_t>& grid_, int lineWords_, int lines_, int line_,
+    int position_, int step_, int targetLine_, int targetPosition_)
+{
+    while (true) {
+        uint64_t blocked, forced;
+        int blockedAt, stopAt, distance;
+        if (step_ > 0) {
+            // bit i is the tile i + 1 steps ahead
+            blocked = lineBits(grid_, lineWords_, lines_, line_, position_ + 1);
+            forced = (lineBits(grid_, lineWords_, lines_, line_ - 1, position_ + 1) & ~lineBits(grid_, lineWords_, lines_, line_ - 1, position_ + 2)) |
+                (lineBits(grid_, lineWords_, lines_, line_ + 1, position_ + 1) & ~lineBits(grid_, lineWords_, lines_, line_ + 1, position_ + 2));
+            blockedAt = blocked ? __builtin_ctzll(blocked) : 64;
+            stopAt = forced ? __builtin_ctzll(forced) : 64;
+            distance = targetPosition_ - position_;
+        }
+        else {
+            // bit 63 - i is the tile i + 1 steps ahead
+            blocked = lineBits(grid_, lineWords_, lines_, line_, position_ - 64);
+            forced = (lineBits(grid_, lineWords_, lines_, line_ - 1, position_ - 64) & ~lineBits(grid_, lineWords_, lines_, line_ - 1, position_ - 65)) |
+                (lineBits(grid_, lineWords_, lines_, line_ + 1, position_ - 64) & ~lineBits(grid_, lineWords_, lines_, line_ + 1, position_ - 65));
+            blockedAt = blocked ? __builtin_clzll(blocked) : 64;
+            stopAt = forced ? __builtin_clzll(forced) : 64;
+            distance = position_ - targetPosition_;
+        }
+        if (line_ == targetLine_ && distance > 0 && distance <= 64) {
+            stopAt = std::min(stopAt, distance - 1);
+        }
+        if (blockedAt <= stopAt && blockedAt < 64) {
+            return -1;
+        }
+        if (stopAt < 64) {
+            return position_ + (stopAt + 1) * step_;
+        }
+        position_ += 64 * step_;
+    }
 }
 
-AStar::Node* AStar::Generator::findNodeOnList(NodeSet& nodes_, Vec2i coordinates_)
+// Jump Point Search (Harabor and Grastien) for this generator's movement rules, where a diagonal step
+// only needs its destination to be free. A tile is a jump point when an optimal path may have to turn
+// there: it has a forced neighbor, a blocked tile next to the run that opens up behind it, or, on a
+// diagonal run, a straight run from it finds a jump point.
+int AStar::Generator::jump(int x_, int y_, int dx_, int dy_, Vec2i target_)
 {
-    for (auto node : nodes_) {
-        if (node->coordinates == coordinates_) {
-            return node;
+    int width = worldSize.x;
+    if (dy_ == 0) {
+        int x = jumpStraight(jumpRows, jumpRowWords, worldSize.y, y_, x_, dx_, target_.y, target_.x);
+        return x == -1 ? -1 : y_ * width + x;
+    }
+    if (dx_ == 0) {
+        int y = jumpStraight(jumpColumns, jumpColumnWords, worldSize.x, x_, y_, dy_, target_.x, target_.y);
+        return y == -1 ? -1 : y * width + x_;
+    }
+    while (true) {
+        x_ += dx_;
+        y_ += dy_;
+        if (isBlocked(x_, y_)) {
+            return -1;
+        }
+        if ((x_ == target_.x && y_ == target_.y) ||
+            (isBlocked(x_ - dx_, y_) && !isBlocked(x_ - dx_, y_ + dy_)) ||
+            (isBlocked(x_, y_ - dy_) && !isBlocked(x_ + dx_, y_ - dy_)) ||
+            jump(x_, y_, dx_, 0, target_) != -1 || jump(x_, y_, 0, dy_, target_) != -1) {
+            return y_ * width + x_;
         }
     }
-    return nullptr;
 }
 
-void AStar::Generator::releaseNodes(NodeSet& nodes_)
+void AStar::Generator::expandJumpPoints(int current_, Vec2i target_)
 {
-    for (auto it = nodes_.begin(); it != nodes_.end();) {
-        delete *it;
-        it = nodes_.erase(it);
+    int width = worldSize.x;
+    int x = current_ % width;
+    int y = current_ / width;
+    // directions worth following: all of them from the source, otherwise the direction of travel with
+    // its natural and forced neighbors
+    Vec2i candidates[8];
+    int count = 0;
+    if (parent[current_] == -1) {
+        for (uint i = 0; i < 8; ++i) {
+            candidates[count++] = direction[i];
+        }
+    }
+    else {
+        int px = parent[current_] % width;
+        int py = parent[current_] / width;
+        int dx = (x > px) - (x < px);
+        int dy = (y > py) - (y < py);
+        if (dx != 0 && dy != 0) {
+            candidates[count++] = { dx, 0 };
+            candidates[count++] = { 0, dy };
+            candidates[count++] = { dx, dy };
+            if (isBlocked(x - dx, y)) {
+                candidates[count++] = { -dx, dy };
+            }
+            if (isBlocked(x, y - dy)) {
+                candidates[count++] = { dx, -dy };
+            }
+        }
+        else if (dx != 0) {
+            candidates[count++] = { dx, 0 };
+            if (isBlocked(x, y + 1)) {
+                candidates[count++] = { dx, 1 };
+            }
+            if (isBlocked(x, y - 1)) {
+                candidates[count++] = { dx, -1 };
+            }
+        }
+        else {
+            candidates[count++] = { 0, dy };
+            if (isBlocked(x + 1, y)) {
+                candidates[count++] = { 1, dy };
+            }
+            if (isBlocked(x - 1, y)) {
+                candidates[count++] = { -1, dy };
+            }
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        int jumpPoint = jump(x, y, candidates[i].x, candidates[i].y, target_);
+        if (jumpPoint == -1) {
+            continue;
+        }
+        Vec2i coordinates = { jumpPoint % width, jumpPoint / width };
+        int straight = std::abs(coordinates.x - x);
+        int diagonal = std::abs(coordinates.y - y);
+        if (straight < diagonal) {
+            std::swap(straight, diagonal);
+        }
+        // diagonal steps first, then straight ones
+        uint cost = gScore[current_] + 14 * diagonal + 10 * (straight - diagonal);
+        reach(jumpPoint, current_, cost, coordinates, target_);
     }
 }
 
 bool AStar::Generator::detectCollision(Vec2i coordinates_)
 {
     if (coordinates_.x < 0 || coordinates_.x >= worldSize.x ||
-        coordinates_.y < 0 || coordinates_.y >= worldSize.y ||
-        std::find(walls.begin(), walls.end(), coordinates_) != walls.end()) {
+        coordinates_.y < 0 || coordinates_.y >= worldSize.y) {
         return true;
     }
-    return false;
+    if (collisionGrid.words != nullptr) {
+        uint64_t word = collisionGrid.words[coordinates_.y * collisionGrid.rowWords + (coordinates_.x >> 6)];
+        if ((word >> (coordinates_.x & 63)) & 1) {
+            return true;
+        }
+    }
+    uint64_t word = collisions[coordinates_.y * collisionRowWords + (coordinates_.x >> 6)];
+    return (word >> (coordinates_.x & 63)) & 1;
 }
 
 AStar::Vec2i AStar::Heuristic::getDelta(Vec2i source_, Vec2i target_)
@@ -9,6 +9,7 @@
 #include <vector>
 #include <functional>
 #include <set>
+#include <cstdint>
 
 namespace AStar
 {
@@ -23,41 +24,105 @@ namespace AStar
     using HeuristicFunction = std::function<uint(Vec2i, Vec2i)>;
     using CoordinateList = std::vector<Vec2i>;
 
-    struct Node
+    // Non-owning view of a bit per tile occupancy grid, rows padded to whole 64 bit words
+    struct CollisionGrid
     {
-        uint G, H;
-        Vec2i coordinates;
-        Node *parent;
-
-        Node(Vec2i coord_, Node *parent_ = nullptr);
-        uint getScore();
+        const uint64_t *words = nullptr;
+        int rowWords = 0;
     };
 
-    using NodeSet = std::vector<Node*>;
-
     class Generator
     {
         bool detectCollision(Vec2i coordinates_);
-        Node* findNodeOnList(NodeSet& nodes_, Vec2i coordinates_);
-        void releaseNodes(NodeSet& nodes_);
+        void prepareSearch();
+        uint64_t heapKey(int tile_) const;
+        void siftUp(int position_);
+        void siftDown(int position_);
+        void pushOpen(int tile_);
+        int popOpen();
+        void reach(int tile_, int from_, uint cost_, Vec2i coordinates_, Vec2i target_);
+        void expandNeighbors(int current_, Vec2i target_);
+        void prepareJumpGrids();
+        static uint64_t lineBits(const std::vector<uint64_t>& grid_, int lineWords_, int lines_, int line_, int start_);
+        bool isBlocked(int x_, int y_);
+        int jumpStraight(const std::vector<uint64_t>& grid_, int lineWords_, int lines_, int line_,
+            int position_, int step_, int targetLine_, int targetPosition_);
+        int jump(int x_, int y_, int dx_, int dy_, Vec2i target_);
+        void expandJumpPoints(int current_, Vec2i target_);
 
     public:
         Generator();
         void setWorldSize(Vec2i worldSize_);
         void setDiagonalMovement(bool enable_);
         void setHeuristic(HeuristicFunction heuristic_);
+        // Jump Point Search instead of plain A*, for diagonal movement only. Expands only the tiles where
+        // a path may turn and finds paths of the same cost as A* with an admissible heuristic
+        // (Heuristic::octagonal). When the target is unreachable, the path leads to the closest jump point.
+        void setJumpPointSearch(bool enable_);
+        // Path from target back to source. When the target can't be reached, the path leads to the
+        // reachable tile closest to it by the heuristic.
         CoordinateList findPath(Vec2i source_, Vec2i target_);
+        // Collisions of the generator's own grid, on top of the referenced grid. Tiles outside the
+        // world size are ignored.
         void addCollision(Vec2i coordinates_);
         void removeCollision(Vec2i coordinates_);
         void clearCollisions();
+        // Replaces the own collisions with the tiles whose value in a row-major layer with the world's
+        // width (a map's wall layer) is above zero
+        template<typename Layer>
+        void setCollisions(const Layer& layer_);
+        // References an occupancy grid kept by someone else, changes to it are seen by the next query
+        void setCollisionGrid(CollisionGrid grid_);
 
     private:
         HeuristicFunction heuristic;
-        CoordinateList direction, walls;
+        CollisionGrid collisionGrid;
+        CoordinateList direction;
         Vec2i worldSize;
         uint directions;
+        bool jumpPointSearch;
+        // collisions of both grids by row and by column for jump point search
+        std::vector<uint64_t> jumpRows;
+        std::vector<uint64_t> jumpColumns;
+        int jumpRowWords;
+        int jumpColumnWords;
+        // own occupancy grid, one bit per tile in rows of collisionRowWords words
+        std::vector<uint64_t> collisions;
+        int collisionRowWords;
+
+        // Search state by tile index, allocated for the world size once and reused by every query.
+        // A tile's scores and parent belong to the current query when its stamp is the query's.
+        std::vector<uint> gScore, fScore;
+        std::vector<int> parent, heapPosition;
+        std::vector<uint32_t> stamp;
+        std::vector<uint64_t> closed;
+        // binary heap of open tiles ordered by f, tiles the query touched to clear their closed bits
+        struct OpenTile
+        {
+            uint64_t key;
+            int tile;
+        };
+        std::vector<OpenTile> openHeap;
+        std::vector<int> touched;
+        uint32_t search;
     };
 
+    template<typename Layer>
+    void Generator::setCollisions(const Layer& layer_)
+    {
+        clearCollisions();
+        size_t count = (size_t)layer_.size();
+        for (int y = 0; y < worldSize.y; ++y) {
+            uint64_t *row = collisions.data() + (size_t)y * collisionRowWords;
+            for (int x = 0; x < worldSize.x; ++x) {
+                size_t index = (size_t)y * worldSize.x + x;
+                if (index < count && layer_[index] > 0) {
+                    row[x >> 6] |= 1ull << (x & 63);
+                }
+            }
+        }
+    }
+
     class Heuristic
     {
         static Vec2i getDelta(Vec2i source_, Vec2i target_);
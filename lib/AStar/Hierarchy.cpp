@@ -0,0 +1,550 @@
+#include "Hierarchy.hpp"
+#include <algorithm>
+#include <queue>
+
+namespace
+{
+    const AStar::Vec2i moves[8] = {
+        { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 },
+        { -1, -1 }, { 1, 1 }, { -1, 1 }, { 1, -1 }
+    };
+
+    // cost first, smallest on top of a std::priority_queue
+    using Open = std::pair<uint64_t, int>;
+    using OpenQueue = std::priority_queue<Open, std::vector<Open>, std::greater<Open>>;
+}
+
+AStar::Hierarchy::Hierarchy(int clusterSize_)
+{
+    clusterSize = std::max(clusterSize_, 2);
+    // entrances are tiles on the edge of a cluster
+    nodesPerCluster = 4 * clusterSize;
+    worldSize = { 0, 0 };
+    clusterCount = { 0, 0 };
+    dirty = false;
+    localOrigin = { 0, 0 };
+    localSize = { 0, 0 };
+    localStride = clusterSize + 2;
+    localSearch = 0;
+    nodeSearch = 0;
+}
+
+void AStar::Hierarchy::setWorldSize(Vec2i worldSize_)
+{
+    worldSize = { std::max(worldSize_.x, 0), std::max(worldSize_.y, 0) };
+    clusterCount = { (worldSize.x + clusterSize - 1) / clusterSize, (worldSize.y + clusterSize - 1) / clusterSize };
+    clusters.assign((size_t)clusterCount.x * clusterCount.y, Cluster());
+    dirty = true;
+}
+
+void AStar::Hierarchy::setCollisionGrid(CollisionGrid grid_)
+{
+    collisionGrid = grid_;
+    invalidate({ 0, 0 }, worldSize);
+}
+
+// A changed tile on the edge of a cluster changes the border with the cluster next to it as well
+void AStar::Hierarchy::invalidate(Vec2i from_, Vec2i to_)
+{
+    if (clusters.empty() || from_.x >= to_.x || from_.y >= to_.y) {
+        return;
+    }
+    int x0 = std::max(from_.x - 1, 0) / clusterSize;
+    int y0 = std::max(from_.y - 1, 0) / clusterSize;
+    int x1 = std::min(std::max(to_.x, 0) / clusterSize, clusterCount.x - 1);
+    int y1 = std::min(std::max(to_.y, 0) / clusterSize, clusterCount.y - 1);
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            clusters[y * clusterCount.x + x].dirty = true;
+            dirty = true;
+        }
+    }
+}
+
+bool AStar::Hierarchy::isBlocked(int x_, int y_) const
+{
+    if (x_ < 0 || x_ >= worldSize.x || y_ < 0 || y_ >= worldSize.y) {
+        return true;
+    }
+    if (collisionGrid.words == nullptr) {
+        return false;
+    }
+    return (collisionGrid.words[(size_t)y_ * collisionGrid.rowWords + (x_ >> 6)] >> (x_ & 63)) & 1;
+}
+
+int AStar::Hierarchy::clusterOf(int tile_) const
+{
+    int x = tile_ % worldSize.x;
+    int y = tile_ / worldSize.x;
+    return (y / clusterSize) * clusterCount.x + x / clusterSize;
+}
+
+int AStar::Hierarchy::entranceOf(int cluster_, int tile_) const
+{
+    auto& entrances = clusters[cluster_].entrances;
+    auto found = std::find(entrances.begin(), entrances.end(), tile_);
+    return found != entrances.end() ? (int)(found - entrances.begin()) : -1;
+}
+
+// Rebuilds the clusters that changed. Their entrances may have moved, so the crossings into them from
+// the clusters around them are looked up again.
+void AStar::Hierarchy::refresh()
+{
+    if (!dirty) {
+        return;
+    }
+    std::vector<char> crossingsChanged(clusters.size(), 0);
+    for (int cluster = 0; cluster < (int)clusters.size(); ++cluster) {
+        if (!clusters[cluster].dirty) {
+            continue;
+        }
+        rebuild(cluster);
+        int column = cluster % clusterCount.x;
+        crossingsChanged[cluster] = 1;
+        if (column > 0) {
+            crossingsChanged[cluster - 1] = 1;
+        }
+        if (column + 1 < clusterCount.x) {
+            crossingsChanged[cluster + 1] = 1;
+        }
+        if (cluster >= clusterCount.x) {
+            crossingsChanged[cluster - clusterCount.x] = 1;
+        }
+        if (cluster + clusterCount.x < (int)clusters.size()) {
+            crossingsChanged[cluster + clusterCount.x] = 1;
+        }
+        // corner crossings
+        int row = cluster / clusterCount.x;
+        for (int dy = -1; dy <= 1; dy += 2) {
+            for (int dx = -1; dx <= 1; dx += 2) {
+                if (column + dx >= 0 && column + dx < clusterCount.x && row + dy >= 0 && row + dy < clusterCount.y) {
+                    crossingsChanged[cluster + dy * clusterCount.x + dx] = 1;
+                }
+            }
+        }
+    }
+    for (int cluster = 0; cluster < (int)clusters.size(); ++cluster) {
+        if (!crossingsChanged[cluster]) {
+            continue;
+        }
+        for (auto& crossing : clusters[cluster].crossings) {
+            int other = clusterOf(crossing.tile);
+            int entrance = entranceOf(other, crossing.tile);
+            crossing.node = entrance >= 0 ? other * nodesPerCluster + entrance : -1;
+        }
+    }
+    dirty = false;
+}
+
+// Both clusters along a border find the same entrances, they scan it in the same direction
+void AStar::Hierarchy::rebuild(int cluster_)
+{
+    Cluster& cluster = clusters[cluster_];
+    int column = cluster_ % clusterCount.x;
+    int row = cluster_ / clusterCount.x;
+    int x0 = column * clusterSize;
+    int y0 = row * clusterSize;
+    int x1 = std::min(x0 + clusterSize, worldSize.x);
+    int y1 = std::min(y0 + clusterSize, worldSize.y);
+
+    cluster.entrances.clear();
+    cluster.crossings.clear();
+    cluster.paths.clear();
+    if (column > 0) {
+        addBorder(cluster, { x0, y0 }, { 0, 1 }, { -1, 0 }, y1 - y0);
+    }
+    if (column + 1 < clusterCount.x) {
+        addBorder(cluster, { x1 - 1, y0 }, { 0, 1 }, { 1, 0 }, y1 - y0);
+    }
+    if (row > 0) {
+        addBorder(cluster, { x0, y0 }, { 1, 0 }, { 0, -1 }, x1 - x0);
+    }
+    if (row + 1 < clusterCount.y) {
+        addBorder(cluster, { x0, y1 - 1 }, { 1, 0 }, { 0, 1 }, x1 - x0);
+    }
+    addCorner(cluster, { x0, y0 }, { -1, -1 });
+    addCorner(cluster, { x1 - 1, y0 }, { 1, -1 });
+    addCorner(cluster, { x0, y1 - 1 }, { -1, 1 });
+    addCorner(cluster, { x1 - 1, y1 - 1 }, { 1, 1 });
+
+    size_t count = cluster.entrances.size();
+    cluster.costs.assign(count * count, NO_PATH);
+    loadCluster(cluster_);
+    for (size_t from = 0; from < count; ++from) {
+        searchCluster(cluster.entrances[from]);
+        for (size_t to = 0; to < count; ++to) {
+            cluster.costs[from * count + to] = clusterCost(cluster.entrances[to]);
+        }
+    }
+    cluster.dirty = false;
+}
+
+// A crossing from a tile of the cluster to the tile at entrance_ + across_ of the cluster next to it
+void AStar::Hierarchy::addEntrance(Cluster& cluster_, Vec2i entrance_, Vec2i across_, uint cost_)
+{
+    int tile = entrance_.y * worldSize.x + entrance_.x;
+    auto found = std::find(cluster_.entrances.begin(), cluster_.entrances.end(), tile);
+    int entrance = (int)(found - cluster_.entrances.begin());
+    if (found == cluster_.entrances.end()) {
+        cluster_.entrances.push_back(tile);
+    }
+    cluster_.crossings.push_back({ entrance, (entrance_.y + across_.y) * worldSize.x + entrance_.x + across_.x, -1, cost_ });
+}
+
+// Entrances for the stretches of a border where the tiles on both sides are free, long stretches get one
+// at each end and short ones one in the middle. A diagonal step across the border gets its own entrance
+// when neither of its tiles is part of a stretch, otherwise the stretch leads to the same tiles.
+void AStar::Hierarchy::addBorder(Cluster& cluster_, Vec2i start_, Vec2i along_, Vec2i across_, int length_)
+{
+    auto add = [&](int offset_) {
+        addEntrance(cluster_, { start_.x + along_.x * offset_, start_.y + along_.y * offset_ }, across_, 10);
+    };
+
+    for (int i = 0; i < length_; ++i) {
+        int x = start_.x + along_.x * i;
+        int y = start_.y + along_.y * i;
+        if (isBlocked(x, y) || !isBlocked(x + across_.x, y + across_.y)) {
+            continue;
+        }
+        for (int side = -1; side <= 1; side += 2) {
+            if (i + side < 0 || i + side >= length_) {
+                continue;
+            }
+            Vec2i diagonal = { across_.x + along_.x * side, across_.y + along_.y * side };
+            if (!isBlocked(x + diagonal.x, y + diagonal.y) && isBlocked(x + along_.x * side, y + along_.y * side)) {
+                addEntrance(cluster_, { x, y }, diagonal, 14);
+            }
+        }
+    }
+
+    int stretch = -1;
+    for (int i = 0; i <= length_; ++i) {
+        int x = start_.x + along_.x * i;
+        int y = start_.y + along_.y * i;
+        if (i < length_ && !isBlocked(x, y) && !isBlocked(x + across_.x, y + across_.y)) {
+            if (stretch < 0) {
+                stretch = i;
+            }
+            continue;
+        }
+        if (stretch < 0) {
+            continue;
+        }
+        if (i - stretch >= 6) {
+            add(stretch);
+            add(i - 1);
+        }
+        else {
+            add(stretch + (i - stretch - 1) / 2);
+        }
+        stretch = -1;
+    }
+}
+
+// A diagonal step from the corner of a cluster into the cluster diagonally next to it, when the tiles
+// beside the step are blocked. Otherwise one of them is on a border stretch that leads there.
+void AStar::Hierarchy::addCorner(Cluster& cluster_, Vec2i corner_, Vec2i across_)
+{
+    if (isBlocked(corner_.x, corner_.y) || isBlocked(corner_.x + across_.x, corner_.y + across_.y)) {
+        return;
+    }
+    if (isBlocked(corner_.x + across_.x, corner_.y) && isBlocked(corner_.x, corner_.y + across_.y)) {
+        addEntrance(cluster_, corner_, across_, 14);
+    }
+}
+
+// Copies the collisions of a cluster for searchCluster
+void AStar::Hierarchy::loadCluster(int cluster_)
+{
+    int column = cluster_ % clusterCount.x;
+    int row = cluster_ / clusterCount.x;
+    localOrigin = { column * clusterSize, row * clusterSize };
+    localSize = { std::min(clusterSize, worldSize.x - localOrigin.x), std::min(clusterSize, worldSize.y - localOrigin.y) };
+    size_t tiles = (size_t)localStride * localStride;
+    if (localStamp.size() != tiles) {
+        localBlocked.assign(tiles, 1);
+        localCost.assign(tiles, NO_PATH);
+        localParent.assign(tiles, -1);
+        localStamp.assign(tiles, 0);
+        localSearch = 0;
+    }
+    std::fill(localBlocked.begin(), localBlocked.end(), 1);
+    for (int y = 0; y < localSize.y; ++y) {
+        for (int x = 0; x < localSize.x; ++x) {
+            localBlocked[(y + 1) * localStride + x + 1] = isBlocked(localOrigin.x + x, localOrigin.y + y);
+        }
+    }
+}
+
+// Index of a tile in the loaded cluster, -1 when it is outside
+int AStar::Hierarchy::localIndex(int tile_) const
+{
+    int x = tile_ % worldSize.x - localOrigin.x;
+    int y = tile_ / worldSize.x - localOrigin.y;
+    if (x < 0 || x >= localSize.x || y < 0 || y >= localSize.y) {
+        return -1;
+    }
+    return (y + 1) * localStride + x + 1;
+}
+
+// Dijkstra from a tile to every tile of the loaded cluster it can reach without leaving the cluster. Steps
+// cost 10 or 14, so the open tiles are kept in a ring of 15 buckets by cost.
+void AStar::Hierarchy::searchCluster(int source_)
+{
+    if (++localSearch == 0) {
+        std::fill(localStamp.begin(), localStamp.end(), 0);
+        localSearch = 1;
+    }
+    int offsets[8];
+    for (int i = 0; i < 8; ++i) {
+        offsets[i] = moves[i].y * localStride + moves[i].x;
+    }
+
+    int start = localIndex(source_);
+    localStamp[start] = localSearch;
+    localCost[start] = 0;
+    localParent[start] = -1;
+    localBuckets[0].push_back(start);
+    size_t pending = 1;
+    for (uint cost = 0; pending > 0; ++cost) {
+        auto& bucket = localBuckets[cost % 15];
+        for (int current : bucket) {
+            pending--;
+            if (localCost[current] != cost) {
+                continue;
+            }
+            for (int i = 0; i < 8; ++i) {
+                int next = current + offsets[i];
+                if (localBlocked[next]) {
+                    continue;
+                }
+                uint total = cost + ((i < 4) ? 10 : 14);
+                if (localStamp[next] != localSearch || total < localCost[next]) {
+                    localStamp[next] = localSearch;
+                    localCost[next] = total;
+                    localParent[next] = current;
+                    localBuckets[total % 15].push_back(next);
+                    pending++;
+                }
+            }
+        }
+        bucket.clear();
+    }
+}
+
+// Cost to a tile of the last cluster search, NO_PATH when the search did not reach it
+AStar::uint AStar::Hierarchy::clusterCost(int tile_) const
+{
+    int local = localIndex(tile_);
+    if (local < 0) {
+        return NO_PATH;
+    }
+    return localStamp[local] == localSearch ? localCost[local] : NO_PATH;
+}
+
+AStar::Hierarchy::Route AStar::Hierarchy::findRoute(Vec2i source_, Vec2i target_)
+{
+    Route route;
+    if (isBlocked(source_.x, source_.y) || isBlocked(target_.x, target_.y)) {
+        return route;
+    }
+    refresh();
+    int sourceTile = source_.y * worldSize.x + source_.x;
+    int targetTile = target_.y * worldSize.x + target_.x;
+    int sourceCluster = clusterOf(sourceTile);
+    int targetCluster = clusterOf(targetTile);
+
+    // source and target join the graph through the entrances of their clusters
+    loadCluster(sourceCluster);
+    searchCluster(sourceTile);
+    std::vector<uint> fromSource;
+    for (int entrance : clusters[sourceCluster].entrances) {
+        fromSource.push_back(clusterCost(entrance));
+    }
+    uint direct = sourceCluster == targetCluster ? clusterCost(targetTile) : NO_PATH;
+    loadCluster(targetCluster);
+    searchCluster(targetTile);
+    std::vector<uint> toTarget;
+    for (int entrance : clusters[targetCluster].entrances) {
+        toTarget.push_back(clusterCost(entrance));
+    }
+
+    int sourceNode = (int)clusters.size() * nodesPerCluster;
+    int targetNode = sourceNode + 1;
+    size_t nodes = (size_t)sourceNode + 2;
+    if (nodeStamp.size() < nodes) {
+        nodeCost.resize(nodes);
+        nodeParent.resize(nodes);
+        nodeStamp.resize(nodes, 0);
+    }
+    if (++nodeSearch == 0) {
+        std::fill(nodeStamp.begin(), nodeStamp.end(), 0);
+        nodeSearch = 1;
+    }
+    auto tileOf = [&](int node_) {
+        int tile = node_ == sourceNode ? sourceTile : node_ == targetNode ? targetTile :
+            clusters[node_ / nodesPerCluster].entrances[node_ % nodesPerCluster];
+        return Vec2i{ tile % worldSize.x, tile / worldSize.x };
+    };
+
+    OpenQueue open;
+    auto reach = [&](int node_, uint cost_, int from_) {
+        if (nodeStamp[node_] == nodeSearch && nodeCost[node_] <= cost_) {
+            return;
+        }
+        nodeStamp[node_] = nodeSearch;
+        nodeCost[node_] = cost_;
+        nodeParent[node_] = from_;
+        // ties go to the node closer to the target (higher cost so far)
+        uint64_t estimate = (uint64_t)cost_ + Heuristic::octagonal(tileOf(node_), target_);
+        open.push({ (estimate << 32) | (uint32_t)~cost_, node_ });
+    };
+
+    reach(sourceNode, 0, -1);
+    while (!open.empty()) {
+        int current = open.top().second;
+        uint cost = ~(uint32_t)open.top().first;
+        open.pop();
+        if (cost > nodeCost[current]) {
+            continue;
+        }
+        if (current == targetNode) {
+            break;
+        }
+        if (current == sourceNode) {
+            int base = sourceCluster * nodesPerCluster;
+            for (size_t i = 0; i < fromSource.size(); ++i) {
+                if (fromSource[i] != NO_PATH) {
+                    reach(base + (int)i, fromSource[i], current);
+                }
+            }
+            if (direct != NO_PATH) {
+                reach(targetNode, direct, current);
+            }
+            continue;
+        }
+        int cluster = current / nodesPerCluster;
+        int entrance = current % nodesPerCluster;
+        const Cluster& inside = clusters[cluster];
+        size_t count = inside.entrances.size();
+        for (size_t to = 0; to < count; ++to) {
+            uint step = inside.costs[entrance * count + to];
+            if (step != NO_PATH && (int)to != entrance) {
+                reach(cluster * nodesPerCluster + (int)to, cost + step, current);
+            }
+        }
+        for (auto& crossing : inside.crossings) {
+            if (crossing.entrance == entrance && crossing.node >= 0) {
+                reach(crossing.node, cost + crossing.cost, current);
+            }
+        }
+        if (cluster == targetCluster && toTarget[entrance] != NO_PATH) {
+            reach(targetNode, cost + toTarget[entrance], current);
+        }
+    }
+
+    if (nodeStamp[targetNode] != nodeSearch) {
+        return route;
+    }
+    for (int node = targetNode; node != -1; node = nodeParent[node]) {
+        Vec2i coordinates = tileOf(node);
+        if (route.waypoints.empty() || !(route.waypoints.back() == coordinates)) {
+            route.waypoints.push_back(coordinates);
+        }
+    }
+    std::reverse(route.waypoints.begin(), route.waypoints.end());
+    return route;
+}
+
+// Tiles after from_ up to to_, two waypoints next to each other on a route
+bool AStar::Hierarchy::refine(Vec2i from_, Vec2i to_, CoordinateList& steps_)
+{
+    steps_.clear();
+    refresh();
+    if (isBlocked(to_.x, to_.y)) {
+        return false;
+    }
+    int fromTile = from_.y * worldSize.x + from_.x;
+    int toTile = to_.y * worldSize.x + to_.x;
+    int cluster = clusterOf(fromTile);
+    if (cluster != clusterOf(toTile)) {
+        // crossing a border or a corner, straight or diagonally
+        if (std::abs(to_.x - from_.x) > 1 || std::abs(to_.y - from_.y) > 1) {
+            return false;
+        }
+        steps_.push_back(to_);
+        return true;
+    }
+
+    Cluster& inside = clusters[cluster];
+    bool entrances = std::find(inside.entrances.begin(), inside.entrances.end(), fromTile) != inside.entrances.end() &&
+        std::find(inside.entrances.begin(), inside.entrances.end(), toTile) != inside.entrances.end();
+    uint64_t key = ((uint64_t)(uint32_t)fromTile << 32) | (uint32_t)toTile;
+    if (entrances) {
+        auto cached = inside.paths.find(key);
+        if (cached != inside.paths.end()) {
+            steps_ = cached->second;
+            return true;
+        }
+    }
+
+    loadCluster(cluster);
+    if (localBlocked[localIndex(fromTile)]) {
+        return false;
+    }
+    searchCluster(fromTile);
+    if (clusterCost(toTile) == NO_PATH) {
+        return false;
+    }
+    int start = localIndex(fromTile);
+    for (int local = localIndex(toTile); local != start; local = localParent[local]) {
+        steps_.push_back({ localOrigin.x + local % localStride - 1, localOrigin.y + local / localStride - 1 });
+    }
+    std::reverse(steps_.begin(), steps_.end());
+    if (entrances) {
+        inside.paths[key] = steps_;
+    }
+    return true;
+}
+
+bool AStar::Hierarchy::nextStep(Route& route_, Vec2i& step_)
+{
+    while (route_.step >= route_.steps.size()) {
+        if (route_.waypoint + 1 >= route_.waypoints.size()) {
+            return false;
+        }
+        if (!refine(route_.waypoints[route_.waypoint], route_.waypoints[route_.waypoint + 1], route_.steps)) {
+            route_.waypoint = route_.waypoints.size();
+            return false;
+        }
+        route_.waypoint++;
+        route_.step = 0;
+    }
+    step_ = route_.steps[route_.step++];
+    return true;
+}
+
+AStar::CoordinateList AStar::Hierarchy::findPath(Vec2i source_, Vec2i target_)
+{
+    CoordinateList path = { source_ };
+    Route route = findRoute(source_, target_);
+    Vec2i step;
+    while (nextStep(route, step)) {
+        path.push_back(step);
+    }
+    if (!(path.back() == target_)) {
+        path.resize(1);
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+size_t AStar::Hierarchy::getEntranceCount()
+{
+    refresh();
+    size_t count = 0;
+    for (auto& cluster : clusters) {
+        count += cluster.entrances.size();
+    }
+    return count;
+}
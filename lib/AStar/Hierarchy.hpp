@@ -0,0 +1,114 @@
+#ifndef __ASTAR_HIERARCHY_HPP__
+#define __ASTAR_HIERARCHY_HPP__
+
+#include "AStar.hpp"
+#include <unordered_map>
+
+namespace AStar
+{
+    // Hierarchical pathfinding (HPA*, Botea, Mueller and Schaeffer) for the movement rules of a Generator
+    // with diagonal movement. The world is cut into square clusters. Neighboring clusters are joined by
+    // entrances where a step leads across their border, and the costs between the entrances of a
+    // cluster are precomputed. A query searches this graph of entrances, which is small compared to the
+    // tiles, and the tiles between two entrances are only looked for when the route gets there.
+    //
+    // Routes use one or two entrances per free stretch of a border, so they can be a few percent longer
+    // than the shortest path. Diagonal steps across a border or a corner of a cluster only get entrances
+    // where no straight crossing next to them leads to the same place.
+    class Hierarchy
+    {
+    public:
+        // An abstract path and the part of it that has been refined to tiles
+        struct Route
+        {
+            // source, entrances along the way and target
+            CoordinateList waypoints;
+            size_t waypoint = 0;
+            // tiles after waypoints[waypoint - 1] up to waypoints[waypoint]
+            CoordinateList steps;
+            size_t step = 0;
+        };
+
+        explicit Hierarchy(int clusterSize_ = 16);
+        void setWorldSize(Vec2i worldSize_);
+        // References an occupancy grid kept by someone else, see invalidate for changes to it
+        void setCollisionGrid(CollisionGrid grid_);
+        // Tiles [from_, to_) of the grid changed, the clusters they touch are rebuilt by the next query
+        void invalidate(Vec2i from_, Vec2i to_);
+        // Route from source to target, without waypoints when the target can't be reached
+        Route findRoute(Vec2i source_, Vec2i target_);
+        // Next tile along a route, the tiles up to the next waypoint are found when the route gets there.
+        // False at the end of the route, or when walls changed so that the rest of it is blocked.
+        bool nextStep(Route& route_, Vec2i& step_);
+        // Whole path from target back to source like Generator::findPath, only the source when the target
+        // can't be reached
+        CoordinateList findPath(Vec2i source_, Vec2i target_);
+        size_t getEntranceCount();
+
+    private:
+        static constexpr uint NO_PATH = ~0u;
+
+        // an entrance of a cluster and the tile across the border it leads to
+        struct Crossing
+        {
+            int entrance;
+            int tile;
+            int node;
+            // 10 straight across, 14 diagonally
+            uint cost;
+        };
+        struct Cluster
+        {
+            // tile indices
+            std::vector<int> entrances;
+            // entrances x entrances, NO_PATH between entrances that are not connected inside the cluster
+            std::vector<uint> costs;
+            std::vector<Crossing> crossings;
+            // tiles between two entrances once a route went there, by entrance tile pair
+            std::unordered_map<uint64_t, CoordinateList> paths;
+            bool dirty = true;
+        };
+
+        bool isBlocked(int x_, int y_) const;
+        int clusterOf(int tile_) const;
+        int entranceOf(int cluster_, int tile_) const;
+        void refresh();
+        void rebuild(int cluster_);
+        void addEntrance(Cluster& cluster_, Vec2i entrance_, Vec2i across_, uint cost_);
+        void addBorder(Cluster& cluster_, Vec2i start_, Vec2i along_, Vec2i across_, int length_);
+        void addCorner(Cluster& cluster_, Vec2i corner_, Vec2i across_);
+        void loadCluster(int cluster_);
+        void searchCluster(int source_);
+        int localIndex(int tile_) const;
+        uint clusterCost(int tile_) const;
+        bool refine(Vec2i from_, Vec2i to_, CoordinateList& steps_);
+
+        int clusterSize;
+        Vec2i worldSize;
+        Vec2i clusterCount;
+        CollisionGrid collisionGrid;
+        std::vector<Cluster> clusters;
+        // entrance e of cluster c is node c * nodesPerCluster + e of the abstract graph, so rebuilding a
+        // cluster leaves the other nodes alone
+        int nodesPerCluster;
+        bool dirty;
+
+        // search inside the loaded cluster, by tile in a copy of the cluster with a blocked frame around it
+        Vec2i localOrigin, localSize;
+        int localStride;
+        std::vector<char> localBlocked;
+        std::vector<uint> localCost;
+        std::vector<int> localParent;
+        std::vector<uint32_t> localStamp;
+        uint32_t localSearch;
+        std::vector<int> localBuckets[15];
+
+        // search of the abstract graph, by node
+        std::vector<uint> nodeCost;
+        std::vector<int> nodeParent;
+        std::vector<uint32_t> nodeStamp;
+        uint32_t nodeSearch;
+    };
+}
+
+#endif // __ASTAR_HIERARCHY_HPP__
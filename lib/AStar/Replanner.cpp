@@ -0,0 +1,425 @@
+#include "Replanner.hpp"
+#include <algorithm>
+
+namespace
+{
+    const int moveX[8] = { 0, 1, 0, -1, -1, 1, -1, 1 };
+    const int moveY[8] = { 1, 0, -1, 0, -1, 1, 1, -1 };
+    const AStar::uint moveCost[8] = { 10, 10, 10, 10, 14, 14, 14, 14 };
+
+    // costs and keys stay below 2^32, the search starts over before they get near
+    const AStar::uint LIMIT = 1u << 30;
+}
+
+AStar::Replanner::Replanner(size_t maxStates_)
+{
+    maxStates = std::max<size_t>(maxStates_, 16);
+    worldSize = { 0, 0 };
+    root = -1;
+    goal = -1;
+    km = 0;
+    visit = 0;
+}
+
+void AStar::Replanner::setWorldSize(Vec2i worldSize_)
+{
+    worldSize = worldSize_;
+    reset();
+}
+
+void AStar::Replanner::setCollisionGrid(CollisionGrid grid_)
+{
+    collisionGrid = grid_;
+    reset();
+}
+
+void AStar::Replanner::invalidate(Vec2i coordinates_)
+{
+    if (coordinates_.x < 0 || coordinates_.x >= worldSize.x || coordinates_.y < 0 || coordinates_.y >= worldSize.y) {
+        return;
+    }
+    changed.push_back(coordinates_.y * worldSize.x + coordinates_.x);
+}
+
+void AStar::Replanner::reset()
+{
+    states.clear();
+    openHeap.clear();
+    changed.clear();
+    root = -1;
+    goal = -1;
+    km = 0;
+}
+
+size_t AStar::Replanner::getStateCount() const
+{
+    return states.size();
+}
+
+bool AStar::Replanner::isBlocked(int tile_) const
+{
+    if (collisionGrid.words == nullptr) {
+        return false;
+    }
+    int x = tile_ % worldSize.x;
+    int y = tile_ / worldSize.x;
+    return (collisionGrid.words[(size_t)y * collisionGrid.rowWords + (x >> 6)] >> (x & 63)) & 1;
+}
+
+int AStar::Replanner::neighbor(int tile_, int direction_) const
+{
+    int x = tile_ % worldSize.x + moveX[direction_];
+    int y = tile_ / worldSize.x + moveY[direction_];
+    if (x < 0 || x >= worldSize.x || y < 0 || y >= worldSize.y) {
+        return -1;
+    }
+    return y * worldSize.x + x;
+}
+
+AStar::uint AStar::Replanner::heuristic(int from_, int to_) const
+{
+    return Heuristic::octagonal({ from_ % worldSize.x, from_ / worldSize.x }, { to_ % worldSize.x, to_ / worldSize.x });
+}
+
+// [min(g, rhs) + h + km, min(g, rhs)] in one number
+uint64_t AStar::Replanner::key(const State& state_, int tile_) const
+{
+    uint cost = std::min(state_.g, state_.rhs);
+    if (cost == INFINITE) {
+        return ~0ull;
+    }
+    return ((uint64_t)(cost + heuristic(tile_, goal) + km) << 32) | cost;
+}
+
+AStar::Replanner::State& AStar::Replanner::at(int tile_)
+{
+    return states[tile_];
+}
+
+AStar::Replanner::State* AStar::Replanner::find(int tile_)
+{
+    auto found = states.find(tile_);
+    return found != states.end() ? &found->second : nullptr;
+}
+
+void AStar::Replanner::siftUp(int position_)
+{
+    OpenTile open = openHeap[position_];
+    while (position_ > 0) {
+        int up = (position_ - 1) / 2;
+        if (openHeap[up].key <= open.key) {
+            break;
+        }
+        openHeap[position_] = openHeap[up];
+        openHeap[position_].state->heapPosition = position_;
+        position_ = up;
+    }
+    openHeap[position_] = open;
+    open.state->heapPosition = position_;
+}
+
+void AStar::Replanner::siftDown(int position_)
+{
+    OpenTile open = openHeap[position_];
+    int count = (int)openHeap.size();
+    while (true) {
+        int child = position_ * 2 + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && openHeap[child + 1].key < openHeap[child].key) {
+            child++;
+        }
+        if (open.key <= openHeap[child].key) {
+            break;
+        }
+        openHeap[position_] = openHeap[child];
+        openHeap[position_].state->heapPosition = position_;
+        position_ = child;
+    }
+    openHeap[position_] = open;
+    open.state->heapPosition = position_;
+}
+
+// Opens a state or moves it to its current key
+void AStar::Replanner::place(State& state_, int tile_)
+{
+    uint64_t newKey = key(state_, tile_);
+    if (state_.heapPosition < 0) {
+        openHeap.push_back({ newKey, tile_, &state_ });
+        siftUp((int)openHeap.size() - 1);
+        return;
+    }
+    int position = state_.heapPosition;
+    uint64_t oldKey = openHeap[position].key;
+    openHeap[position].key = newKey;
+    if (newKey < oldKey) {
+        siftUp(position);
+    }
+    else {
+        siftDown(position);
+    }
+}
+
+void AStar::Replanner::remove(State& state_)
+{
+    int position = state_.heapPosition;
+    if (position < 0) {
+        return;
+    }
+    state_.heapPosition = -1;
+    OpenTile last = openHeap.back();
+    openHeap.pop_back();
+    if (position == (int)openHeap.size()) {
+        return;
+    }
+    openHeap[position] = last;
+    last.state->heapPosition = position;
+    siftDown(position);
+    siftUp(last.state->heapPosition);
+}
+
+// rhs from the best neighbor, the state is open while it is inconsistent
+void AStar::Replanner::updateState(int tile_)
+{
+    State& state = at(tile_);
+    if (tile_ != root) {
+        state.rhs = INFINITE;
+        state.parent = -1;
+        if (!isBlocked(tile_)) {
+            for (int i = 0; i < 8; ++i) {
+                int from = neighbor(tile_, i);
+                State* previous = from < 0 ? nullptr : find(from);
+                if (previous == nullptr || previous->g == INFINITE) {
+                    continue;
+                }
+                uint cost = previous->g + moveCost[i];
+                if (cost < state.rhs) {
+                    state.rhs = cost;
+                    state.parent = from;
+                }
+            }
+        }
+    }
+    if (state.g != state.rhs) {
+        place(state, tile_);
+    }
+    else {
+        remove(state);
+    }
+}
+
+// The agent moved to a tile of the search tree. Its subtree keeps its costs, they are all off by the cost
+// of the tile, which stays as the root's cost. The rest of the tree is dropped and the tiles around the
+// subtree are opened again.
+bool AStar::Replanner::moveRoot(int tile_)
+{
+    State* newRoot = find(tile_);
+    if (newRoot == nullptr || newRoot->g == INFINITE || newRoot->g != newRoot->rhs) {
+        return false;
+    }
+    if (tile_ == root) {
+        return true;
+    }
+    if (++visit == 0) {
+        for (auto& entry : states) {
+            entry.second.visit = 0;
+        }
+        visit = 1;
+    }
+
+    std::vector<int> pending = { tile_ };
+    newRoot->visit = visit;
+    while (!pending.empty()) {
+        int current = pending.back();
+        pending.pop_back();
+        for (int i = 0; i < 8; ++i) {
+            int next = neighbor(current, i);
+            State* child = next < 0 ? nullptr : find(next);
+            if (child != nullptr && child->parent == current && child->visit != visit) {
+                child->visit = visit;
+                pending.push_back(next);
+            }
+        }
+    }
+
+    std::vector<int> dropped;
+    for (auto& entry : states) {
+        State& state = entry.second;
+        if (state.visit == visit) {
+            continue;
+        }
+        remove(state);
+        state.g = INFINITE;
+        state.rhs = INFINITE;
+        state.parent = -1;
+        dropped.push_back(entry.first);
+    }
+    root = tile_;
+    newRoot->parent = -1;
+    for (int tile : dropped) {
+        updateState(tile);
+    }
+    for (int tile : dropped) {
+        auto found = states.find(tile);
+        if (found->second.rhs == INFINITE) {
+            states.erase(found);
+        }
+    }
+    return true;
+}
+
+// LPA* until the goal is consistent and nothing in the heap can lead to a cheaper path to it
+bool AStar::Replanner::computePath()
+{
+    State& target = at(goal);
+    while (!openHeap.empty()) {
+        if (states.size() > maxStates) {
+            return false;
+        }
+        if (openHeap[0].key >= key(target, goal) && target.rhs == target.g) {
+            break;
+        }
+        int tile = openHeap[0].tile;
+        State& state = *openHeap[0].state;
+        uint64_t newKey = key(state, tile);
+        if (openHeap[0].key < newKey) {
+            openHeap[0].key = newKey;
+            siftDown(0);
+            continue;
+        }
+        if (state.g > state.rhs) {
+            state.g = state.rhs;
+            remove(state);
+            for (int i = 0; i < 8; ++i) {
+                int next = neighbor(tile, i);
+                if (next < 0 || next == root || isBlocked(next)) {
+                    continue;
+                }
+                State& successor = at(next);
+                uint cost = state.g + moveCost[i];
+                if (cost < successor.rhs) {
+                    successor.rhs = cost;
+                    successor.parent = tile;
+                    if (successor.g != successor.rhs) {
+                        place(successor, next);
+                    }
+                    else {
+                        remove(successor);
+                    }
+                }
+            }
+        }
+        else {
+            state.g = INFINITE;
+            updateState(tile);
+            for (int i = 0; i < 8; ++i) {
+                int next = neighbor(tile, i);
+                State* successor = next < 0 ? nullptr : find(next);
+                if (successor != nullptr && successor->parent == tile) {
+                    updateState(next);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void AStar::Replanner::restart(int source_, int target_)
+{
+    reset();
+    root = source_;
+    goal = target_;
+    State& start = at(root);
+    start.rhs = 0;
+    place(start, root);
+}
+
+bool AStar::Replanner::search(int source_, int target_)
+{
+    State* current = root < 0 ? nullptr : find(root);
+    if (current == nullptr || km > LIMIT || current->g > LIMIT) {
+        restart(source_, target_);
+    }
+    if (target_ != goal) {
+        km += heuristic(goal, target_);
+        goal = target_;
+    }
+    for (int tile : changed) {
+        bool reached = find(tile) != nullptr;
+        for (int i = 0; i < 8 && !reached; ++i) {
+            int next = neighbor(tile, i);
+            reached = next >= 0 && find(next) != nullptr;
+        }
+        if (!reached) {
+            continue;
+        }
+        updateState(tile);
+        for (int i = 0; i < 8; ++i) {
+            int next = neighbor(tile, i);
+            if (next >= 0 && find(next) != nullptr) {
+                updateState(next);
+            }
+        }
+    }
+    changed.clear();
+    return computePath();
+}
+
+// Path from the goal back to the agent, the search may still be rooted behind the agent
+bool AStar::Replanner::tracePath(int source_, CoordinateList& path_)
+{
+    path_.clear();
+    State* target = find(goal);
+    if (target == nullptr || target->g == INFINITE) {
+        return false;
+    }
+    for (int tile = goal; tile != -1; tile = states[tile].parent) {
+        path_.push_back({ tile % worldSize.x, tile / worldSize.x });
+        if (tile == source_) {
+            return true;
+        }
+        if (path_.size() > states.size()) {
+            break;
+        }
+    }
+    path_.clear();
+    return false;
+}
+
+AStar::CoordinateList AStar::Replanner::findPath(Vec2i source_, Vec2i target_)
+{
+    CoordinateList path;
+    if (source_.x < 0 || source_.x >= worldSize.x || source_.y < 0 || source_.y >= worldSize.y ||
+        target_.x < 0 || target_.x >= worldSize.x || target_.y < 0 || target_.y >= worldSize.y) {
+        path.push_back(source_);
+        return path;
+    }
+    int source = source_.y * worldSize.x + source_.x;
+    int target = target_.y * worldSize.x + target_.x;
+    // A shortest path from the root through the agent's tile is one from the agent as well, so while
+    // the agent follows its path the search keeps its root. It moves up to the agent when the path
+    // goes elsewhere.
+    bool found = search(source, target);
+    if (found && tracePath(source, path)) {
+        return path;
+    }
+    if (!found && root == source) {
+        // a search from the agent ran out of tiles already
+        reset();
+        path.assign(1, source_);
+        return path;
+    }
+    if (!found || !moveRoot(source)) {
+        restart(source, target);
+    }
+    if (!computePath()) {
+        reset();
+        path.assign(1, source_);
+        return path;
+    }
+    if (!tracePath(source, path)) {
+        path.assign(1, source_);
+    }
+    return path;
+}
@@ -0,0 +1,86 @@
+#ifndef __ASTAR_REPLANNER_HPP__
+#define __ASTAR_REPLANNER_HPP__
+
+#include "AStar.hpp"
+#include <unordered_map>
+
+namespace AStar
+{
+    // Incremental search for an agent chasing a moving target (Moving Target D* Lite, Sun, Yeoh and
+    // Koenig), with the movement rules of a Generator with diagonal movement. The search tree grows
+    // from the agent and is kept between queries: when the target moves the search just continues,
+    // while the agent walks along its path the tree stays as it is, when it leaves the path the tree is
+    // moved up to it and the part behind it dropped, and changed walls only reopen the tiles around
+    // them. Each query finds an optimal path, usually after looking at a few tiles instead of
+    // searching again.
+    //
+    // One replanner per agent. It keeps at most maxStates tiles, a search that needs more starts over
+    // and gives up when it can't do with that either.
+    class Replanner
+    {
+    public:
+        explicit Replanner(size_t maxStates_ = 16384);
+        void setWorldSize(Vec2i worldSize_);
+        // References an occupancy grid kept by someone else, see invalidate for changes to it
+        void setCollisionGrid(CollisionGrid grid_);
+        // The collision of a tile changed, the next query repairs the search around it. Tiles the search
+        // never got near cost a lookup.
+        void invalidate(Vec2i coordinates_);
+        // Drops the search, the next query starts from scratch
+        void reset();
+        // Path from target back to source like Generator::findPath, only the source when the target
+        // can't be reached within maxStates tiles
+        CoordinateList findPath(Vec2i source_, Vec2i target_);
+        size_t getStateCount() const;
+
+    private:
+        static constexpr uint INFINITE = ~0u;
+
+        struct State
+        {
+            uint g = INFINITE;
+            uint rhs = INFINITE;
+            int parent = -1;
+            int heapPosition = -1;
+            uint32_t visit = 0;
+        };
+        // states live in an unordered_map, which never moves them
+        struct OpenTile
+        {
+            uint64_t key;
+            int tile;
+            State* state;
+        };
+
+        bool isBlocked(int tile_) const;
+        int neighbor(int tile_, int direction_) const;
+        uint heuristic(int from_, int to_) const;
+        uint64_t key(const State& state_, int tile_) const;
+        State& at(int tile_);
+        State* find(int tile_);
+        void siftUp(int position_);
+        void siftDown(int position_);
+        void place(State& state_, int tile_);
+        void remove(State& state_);
+        void updateState(int tile_);
+        bool moveRoot(int tile_);
+        bool computePath();
+        void restart(int source_, int target_);
+        bool search(int source_, int target_);
+        bool tracePath(int source_, CoordinateList& path_);
+
+        size_t maxStates;
+        Vec2i worldSize;
+        CollisionGrid collisionGrid;
+        std::unordered_map<int, State> states;
+        std::vector<OpenTile> openHeap;
+        std::vector<int> changed;
+        int root;
+        int goal;
+        // heuristic drift of the keys in the heap, grows with every move of the target
+        uint km;
+        uint32_t visit;
+    };
+}
+
+#endif // __ASTAR_REPLANNER_HPP__
@@ -9,8 +9,12 @@
 #include "src/Raycaster.h"
 #include "src/Level.h"
 #include "src/Textures.h"
+#include "src/TextureDecoder.h"
 #include "src/Entities.h"
 #include "src/Mask.h"
+#include "src/FlowField.h"
+#include "src/PathService.h"
+#include "src/LevelLoader.h"
 
 #include "lib/AStar/AStar.hpp"
 
@@ -41,10 +45,10 @@ void update(double dt, Player* player) {
     player->onUpdate(dt);
 }
 
-void renderBackground(shared_ptr<Texture2D> background) {
+void renderBackground(const Texture2D &background) {
     DrawTexturePro(
-            *background,
-            Rectangle { 0, 0, (float)background->width, (float)background->height },
+            background,
+            Rectangle { 0, 0, (float)background.width, (float)background.height },
             Rectangle { 0, 0, Config::DISPLAY_WIDTH, Config::DISPLAY_HEIGHT },
             Vector2 { 0, 0, },
             0,
@@ -52,71 +56,70 @@ void renderBackground(shared_ptr<Texture2D> background) {
     );
 }
 
-void renderHand(Player * player, unique_ptr<Textures> &textures) {
-    auto handTexture = textures->get("hand");
+void renderHand(Player * player, const Texture2D &handTexture) {
     auto color = Color { 64, 64, 64, 255 };
     color = ColorBrightness(color, player->brightness);
     float mod = player->isRunning ? 16.0f : 8.0f;
     float offsetY = sin(player->movingTime * mod) * 8.0f;
-    DrawTexture(*handTexture, Config::DISPLAY_WIDTH / 2 + handTexture->width / 2, Config::DISPLAY_HEIGHT - handTexture->height + offsetY + 16, color);
+    DrawTexture(handTexture, Config::DISPLAY_WIDTH / 2 + handTexture.width / 2, Config::DISPLAY_HEIGHT - handTexture.height + offsetY + 16, color);
 }
 
-void render(Player *player, Raycaster& raycaster, unique_ptr<Textures> &textures) {
+void render(Player *player, Raycaster& raycaster, unique_ptr<Textures> &textures, TextureHandle background, TextureHandle hand) {
     // ClearBackground(BLACK);
-    renderBackground(textures->get("background"));
+    renderBackground(textures->get(background));
     raycaster.renderFloor();
     raycaster.renderRaycaster();
     raycaster.drawSprites();
 
-    renderHand(player, textures);
+    renderHand(player, textures->get(hand));
 }
 
-int main() {
+void renderLoadingScreen(float progress, const string &stage) {
+    int barWidth = Config::WINDOW_WIDTH / 2;
+    int barX = (Config::WINDOW_WIDTH - barWidth) / 2;
+    int barY = Config::WINDOW_HEIGHT / 2;
+    BeginDrawing();
+        ClearBackground(BLACK);
+        DrawText("Loading", barX, barY - 40, 20, WHITE);
+        DrawRectangle(barX, barY, barWidth, 8, DARKGRAY);
+        DrawRectangle(barX, barY, (int)((float)barWidth * progress), 8, WHITE);
+        DrawText(stage.c_str(), barX, barY + 16, 10, GRAY);
+    EndDrawing();
+}
+
+// Decodes and uploads the textures that are wanted but not loaded yet, with the loading screen up
+void loadTextures(Textures &textures, TextureCache &cache, Music &music) {
+    TextureDecoder decoder(textures.getMissing(), &cache);
+    while (!decoder.isDone()) {
+        decoder.upload(textures);
+        UpdateMusicStream(music);
+        renderLoadingScreen(decoder.getProgress(), "Loading textures");
+    }
+}
+
+// Plays a loaded level until the window is closed or the player walks through an exit, returns
+// the level the exit leads to
+string play(LoadedLevel &loaded, unique_ptr<Textures> &textures, Music &music) {
     auto isGameRunning = std::atomic<bool>(true);;
     auto deltaTime = std::atomic<double>(0);
-    auto currentTime = std::atomic<double>(0.0);
+    auto currentTime = std::atomic<double>(GetTime());
     auto isUpdateFinished = std::atomic<bool>(false);
 
-    InitWindow(Config::WINDOW_WIDTH, Config::WINDOW_HEIGHT, Config::WINDOW_TITLE.c_str());
-    InitAudioDevice();
-
-    auto textures = make_unique<Textures>();
+    auto &map = loaded.map;
+    auto &gameObjects = loaded.objects;
 
-    for (auto &tex : Config::TEXTURE_MAP) {
-        textures->add(tex.first, tex.second);
-    }
-
-    SetTargetFPS(60);
+    auto &solid = map->getSolidGrid();
+    // searches with diagonal movement and jump point search, long ones through a hierarchy, see PathOptions
+    PathService paths(solid, Config::PATH_WORKERS);
 
-    auto level = Level("assets/maps/dungeon/dungeon-1.json");
-    auto level_size = level.getSize();
-
-    auto pathGenerator = make_unique<AStar::Generator>();
-
-    pathGenerator->setWorldSize({ level_size.x, level_size.y });
-
-    auto map = make_unique<Map>(level_size.x, level_size.y, 0);
-    auto wallsLayerData = level.getLayerData("walls");
-    auto floorLayerData = level.getLayerData("floor");
-    auto ceilingLayerData = level.getLayerData("ceiling");
-    auto gameObjects = level.getObjects();
-    map->setWalls(wallsLayerData);
-    map->setFloor(floorLayerData);
-    map->setCeiling(ceilingLayerData);
-    map->autoLightMap();
-
-    pathGenerator->setDiagonalMovement(true);
-    for (int i = 0; i < wallsLayerData.size(); i++) {
-        if (wallsLayerData[i] > 0) {
-            int x = i % level_size.x;
-            int y = i / level_size.x;
-            pathGenerator->addCollision({ x, y });
-        }
-    }
+    // one field toward the player for everything chasing them, updated by the update thread
+    FlowField chaseField(solid, Config::CHASE_RANGE);
 
     auto player = make_unique<Player>(map.get());
     player->position = { 20.5, 20.5 };
     player->rotation = 180;
+    map->prefetch((int)player->position.x, (int)player->position.y);
+    map->printMemoryReport();
 
     RenderTexture2D canvas = LoadRenderTexture(Config::DISPLAY_WIDTH, Config::DISPLAY_HEIGHT);
     Rectangle canvasSource = { 0, 0, Config::DISPLAY_WIDTH, -Config::DISPLAY_HEIGHT };
@@ -124,19 +127,16 @@ int main() {
 
     Raycaster raycaster(map.get(), player.get(), textures);
     raycaster.setAtlas("textures");
+    auto backgroundTexture = textures->handle("background");
+    auto handTexture = textures->handle("hand");
 
     for (auto &obj : gameObjects) {
         raycaster.addObject(obj);
     }
 
-    raycaster.assignLightMap();
-
-    auto music = LoadMusicStream("assets/music/MyVeryOwnDeadShip.ogg");
-
     Entities entities;
-    auto maskTexture = textures->get("mask");
-    auto maskSpriteId = raycaster.addSprite(Sprite({0, 0}, *maskTexture));
-    Mask mask(player, pathGenerator);
+    auto maskSpriteId = raycaster.addSprite(Sprite({0, 0}, textures->handle("mask")));
+    Mask mask(player, solid, paths, chaseField);
     mask.setSpriteId(maskSpriteId);
     entities.add(mask);
     mask.reset();
@@ -151,8 +151,11 @@ int main() {
                 std::this_thread::sleep_for(delay);
             }
             currentTime = now;
+            // streamed chunks change solid and distances between ticks, see Map::updateStreaming
+            auto gridLock = map->lockGrid();
             entities.update(deltaTime, raycaster);
             update(deltaTime, player.get());
+            chaseField.setTarget(player->tile_x, player->tile_y);
             mask.update(deltaTime);
             raycaster.setSpritePosition(mask.spriteId, mask.position);
             raycaster.update(deltaTime);
@@ -164,16 +167,17 @@ int main() {
     std::thread updateThread(onUpdate);
     updateThread.detach();
 
-    music.looping = true;
-    PlayMusicStream(music);
-
     char* txt;
+    string exit;
 
     while (!WindowShouldClose())
     {
         UpdateMusicStream(music);
+        map->updateStreaming(player->tile_x, player->tile_y);
+        exit = loaded.exitAt(player->tile_x, player->tile_y);
+        if (!exit.empty()) break;
         BeginTextureMode(canvas);
-            render(player.get(), raycaster, textures);
+            render(player.get(), raycaster, textures, backgroundTexture, handTexture);
         EndTextureMode();
 
         BeginDrawing();
@@ -193,6 +197,51 @@ int main() {
 
     UnloadRenderTexture(canvas);
 
+    return exit;
+}
+
+int main() {
+    InitWindow(Config::WINDOW_WIDTH, Config::WINDOW_HEIGHT, Config::WINDOW_TITLE.c_str());
+    InitAudioDevice();
+    SetTargetFPS(60);
+
+    // the level loads in the background while textures, which need the GL context, load here
+    LevelLoader loader;
+    loader.load("assets/maps/dungeon/dungeon-1.json");
+
+    auto music = LoadMusicStream("assets/music/MyVeryOwnDeadShip.ogg");
+    music.looping = true;
+    PlayMusicStream(music);
+
+    auto textures = make_unique<Textures>(Config::LEVEL_TEXTURE_BUDGET);
+    // entries written on a cold start are finished in the background while the game runs
+    TextureCache textureCache(Config::TEXTURE_CACHE_DIRECTORY);
+    AssetManifest manifest(Config::TEXTURE_MANIFEST);
+    for (auto &entry : manifest.getEntries()) {
+        textures->declare(entry);
+    }
+    // everything but the level textures
+    loadTextures(*textures, textureCache, music);
+
+    while (loader.isLoading()) {
+        while (!loader.isReady() && !WindowShouldClose()) {
+            UpdateMusicStream(music);
+            renderLoadingScreen(loader.getProgress(), loader.getStage());
+        }
+        if (!loader.isReady()) break;
+        auto loaded = loader.take();
+        // textures of the previous level that this one does not use are evicted once it is over budget
+        TextureSet levelTextures(*textures, loaded->getTextureNames());
+        loadTextures(*textures, textureCache, music);
+        textures->evict();
+        // the next level loads while this one is played
+        loader.preload(loaded->nextLevel());
+        auto exit = play(*loaded, textures, music);
+        if (!exit.empty()) loader.load(exit);
+    }
+
+    UnloadMusicStream(music);
+
     CloseAudioDevice();
     CloseWindow();
 
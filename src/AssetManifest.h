@@ -0,0 +1,67 @@
+#ifndef RENEGADE_ENGINE_ASSETMANIFEST_H
+#define RENEGADE_ENGINE_ASSETMANIFEST_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+#include <unordered_map>
+#include <stdexcept>
+
+using namespace std;
+
+// The list of textures the game loads, one "name file" pair per line with the file relative to the
+// manifest, followed by "level" for textures that are only loaded for levels using them. Empty lines and
+// lines starting with # are skipped. A name listed twice is loaded once.
+class AssetManifest {
+public:
+    struct Entry {
+        string name;
+        string path;
+        bool perLevel;
+    };
+private:
+    vector<Entry> entries;
+public:
+    explicit AssetManifest(const string &manifestPath) {
+        ifstream file(manifestPath);
+        if (!file) throw runtime_error("Could not open asset manifest " + manifestPath);
+        auto directory = filesystem::path(manifestPath).parent_path();
+        unordered_map<string, size_t> byName;
+        string line;
+        int lineNumber = 0;
+        while (getline(file, line)) {
+            lineNumber++;
+            istringstream fields(line);
+            string name;
+            string path;
+            if (!(fields >> name) || name[0] == '#') continue;
+            if (!(fields >> path)) {
+                throw runtime_error("Missing file for " + name + " in " + manifestPath + ":" + to_string(lineNumber));
+            }
+            string residency;
+            fields >> residency;
+            if (!residency.empty() && residency != "level") {
+                throw runtime_error("Unknown residency " + residency + " for " + name + " in " + manifestPath + ":" + to_string(lineNumber));
+            }
+            path = (directory / path).lexically_normal().string();
+            auto found = byName.find(name);
+            if (found != byName.end()) {
+                if (entries[found->second].path != path) {
+                    cout << "WARNING: " << name << " is listed twice in " << manifestPath << ", using " << entries[found->second].path << endl;
+                }
+                continue;
+            }
+            byName[name] = entries.size();
+            entries.push_back({ name, path, residency == "level" });
+        }
+    }
+
+    [[nodiscard]] const vector<Entry> &getEntries() const {
+        return entries;
+    }
+};
+
+#endif //RENEGADE_ENGINE_ASSETMANIFEST_H
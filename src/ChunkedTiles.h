@@ -0,0 +1,282 @@
+#ifndef RENEGADE_ENGINE_CHUNKEDTILES_H
+#define RENEGADE_ENGINE_CHUNKEDTILES_H
+
+#include <vector>
+#include <list>
+#include <cstdint>
+#include <cstdlib>
+#include <climits>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+#include <functional>
+#include "../config.hpp"
+#include "TileGrid.h"
+
+using namespace std;
+
+using ChunkCell = TileCell<Config::TileIdType>;
+
+struct Chunk {
+    static constexpr int SHIFT = Config::CHUNK_SHIFT;
+    static constexpr int SIZE = 1 << SHIFT;
+    static constexpr int MASK = SIZE - 1;
+
+    int x { 0 };
+    int y { 0 };
+    ChunkCell cells[SIZE * SIZE] {};
+};
+
+static inline uint64_t chunkKey(int cx, int cy) {
+    return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+}
+
+// Produces the tiles of a chunk. Called from the streaming thread, so it must not touch engine state.
+class ChunkSource {
+public:
+    virtual ~ChunkSource() = default;
+    // Returns false if there is nothing at these chunk coordinates
+    virtual bool load(int cx, int cy, Chunk &chunk) = 0;
+};
+
+// Tile layers split into chunks that are paged in around a center (the player) by a background thread.
+// Resident chunks live in a ring of RING x RING slots addressed by chunk coordinates modulo RING, so a
+// tile lookup is a shift, a mask and a compare. Chunks leaving the ring go to an LRU cache first and are
+// only freed once they drop out of it.
+// This bounds the tiles the renderer works on, not the memory of the map: the source still holds the
+// whole level, see TilesonChunkSource.
+class ChunkedTiles {
+public:
+    static constexpr int RING_SHIFT = Config::STREAMING_RING_SHIFT;
+    static constexpr int RING = 1 << RING_SHIFT;
+    static constexpr int RING_MASK = RING - 1;
+    // chunks around the center chunk that are kept resident, the ring needs one spare row for paging
+    static constexpr int RADIUS = RING / 2 - 1;
+private:
+    unique_ptr<ChunkSource> source;
+    // render and update threads only read the slots, so publishing a pointer is all the syncing they need
+    atomic<Chunk *> ring[RING * RING];
+    list<unique_ptr<Chunk>> resident;
+    list<unique_ptr<Chunk>> cache;
+    size_t cacheSize;
+    function<void(const Chunk &)> onInstall;
+    // held while chunks are freed, see pin
+    mutable mutex pinMutex;
+
+    // streaming thread
+    thread worker;
+    mutex queueMutex;
+    condition_variable queueSignal;
+    vector<pair<int, int>> requests;
+    vector<unique_ptr<Chunk>> loaded;
+    unordered_set<uint64_t> pending;
+    bool stopWorker { false };
+
+    int centerX { INT32_MIN };
+    int centerY { INT32_MIN };
+
+    void work() {
+        while (true) {
+            pair<int, int> request;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                queueSignal.wait(lock, [this]() { return stopWorker || !requests.empty(); });
+                if (stopWorker) return;
+                // nearest request first, they are sorted by distance when queued
+                request = requests.back();
+                requests.pop_back();
+            }
+            auto chunk = make_unique<Chunk>();
+            chunk->x = request.first;
+            chunk->y = request.second;
+            bool hasTiles = source->load(request.first, request.second, *chunk);
+            lock_guard<mutex> lock(queueMutex);
+            if (hasTiles) {
+                loaded.push_back(std::move(chunk));
+            } else {
+                pending.erase(chunkKey(request.first, request.second));
+            }
+        }
+    }
+
+    [[nodiscard]] bool isWanted(int cx, int cy) const {
+        return abs(cx - centerX) <= RADIUS && abs(cy - centerY) <= RADIUS;
+    }
+
+    atomic<Chunk *> &slot(int cx, int cy) {
+        return ring[((cy & RING_MASK) << RING_SHIFT) | (cx & RING_MASK)];
+    }
+
+    void install(unique_ptr<Chunk> chunk) {
+        auto &target = slot(chunk->x, chunk->y);
+        target.store(chunk.get(), memory_order_release);
+        if (onInstall) onInstall(*chunk);
+        resident.push_back(std::move(chunk));
+    }
+
+    // Moves chunks that left the ring into the LRU cache and frees the least recently used ones
+    void evict() {
+        for (auto it = resident.begin(); it != resident.end();) {
+            Chunk *chunk = it->get();
+            if (isWanted(chunk->x, chunk->y)) {
+                it++;
+                continue;
+            }
+            // the chunk is only freed once it drops out of the cache, so a lookup that still holds it stays valid
+            auto &target = slot(chunk->x, chunk->y);
+            Chunk *expected = chunk;
+            target.compare_exchange_strong(expected, nullptr, memory_order_release);
+            cache.push_front(std::move(*it));
+            it = resident.erase(it);
+        }
+        lock_guard<mutex> lock(pinMutex);
+        while (cache.size() > cacheSize) {
+            cache.pop_back();
+        }
+    }
+
+    // Takes a chunk out of the LRU cache
+    unique_ptr<Chunk> fromCache(int cx, int cy) {
+        for (auto it = cache.begin(); it != cache.end(); it++) {
+            if ((*it)->x == cx && (*it)->y == cy) {
+                auto chunk = std::move(*it);
+                cache.erase(it);
+                return chunk;
+            }
+        }
+        return nullptr;
+    }
+
+public:
+    explicit ChunkedTiles(unique_ptr<ChunkSource> chunkSource, size_t cacheSize = Config::STREAMING_CACHE_CHUNKS)
+        : source(std::move(chunkSource)), cacheSize(cacheSize) {
+        for (auto &s : ring) {
+            s.store(nullptr);
+        }
+        worker = thread([this]() { this->work(); });
+    }
+
+    ~ChunkedTiles() {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopWorker = true;
+        }
+        queueSignal.notify_all();
+        worker.join();
+    }
+
+    ChunkedTiles(const ChunkedTiles &) = delete;
+    ChunkedTiles &operator=(const ChunkedTiles &) = delete;
+
+    // Called on the render thread whenever a chunk becomes resident
+    void setOnInstall(function<void(const Chunk &)> callback) {
+        this->onInstall = std::move(callback);
+    }
+
+    // Keeps every chunk alive while the lock is held. Threads other than the one calling update hold it
+    // for as long as they use cells from cellAt.
+    [[nodiscard]] unique_lock<mutex> pin() const {
+        return unique_lock<mutex>(pinMutex);
+    }
+
+    // Returns the cell at a tile position or nullptr if its chunk is not resident
+    [[nodiscard]] inline const ChunkCell *cellAt(int x, int y) const {
+        int cx = x >> Chunk::SHIFT;
+        int cy = y >> Chunk::SHIFT;
+        const Chunk *chunk = ring[((cy & RING_MASK) << RING_SHIFT) | (cx & RING_MASK)].load(memory_order_acquire);
+        if (chunk == nullptr || chunk->x != cx || chunk->y != cy) return nullptr;
+        return &chunk->cells[((y & Chunk::MASK) << Chunk::SHIFT) | (x & Chunk::MASK)];
+    }
+
+    // Installs chunks the streaming thread finished and requests the ones missing around the given tile.
+    // Call from the render thread between frames.
+    void update(int tileX, int tileY) {
+        vector<unique_ptr<Chunk>> finished;
+        {
+            lock_guard<mutex> lock(queueMutex);
+            finished.swap(loaded);
+            for (auto &chunk : finished) {
+                pending.erase(chunkKey(chunk->x, chunk->y));
+            }
+        }
+
+        int cx = tileX >> Chunk::SHIFT;
+        int cy = tileY >> Chunk::SHIFT;
+        bool centerChanged = cx != centerX || cy != centerY;
+        centerX = cx;
+        centerY = cy;
+        if (centerChanged) evict();
+
+        for (auto &chunk : finished) {
+            if (isWanted(chunk->x, chunk->y)) {
+                install(std::move(chunk));
+            } else {
+                cache.push_front(std::move(chunk));
+            }
+        }
+        if (!centerChanged && finished.empty()) return;
+
+        vector<pair<int, int>> missing;
+        for (int y = cy - RADIUS; y <= cy + RADIUS; y++) {
+            for (int x = cx - RADIUS; x <= cx + RADIUS; x++) {
+                if (cellAt(x * Chunk::SIZE, y * Chunk::SIZE) != nullptr) continue;
+                auto cached = fromCache(x, y);
+                if (cached) {
+                    install(std::move(cached));
+                    continue;
+                }
+                missing.emplace_back(x, y);
+            }
+        }
+        // farthest first, the worker takes from the back
+        sort(missing.begin(), missing.end(), [cx, cy](auto &a, auto &b) {
+            return max(abs(a.first - cx), abs(a.second - cy)) > max(abs(b.first - cx), abs(b.second - cy));
+        });
+        {
+            lock_guard<mutex> lock(queueMutex);
+            // drop requests that are no longer around the center
+            requests.erase(remove_if(requests.begin(), requests.end(), [this](auto &r) {
+                bool drop = !isWanted(r.first, r.second);
+                if (drop) pending.erase(chunkKey(r.first, r.second));
+                return drop;
+            }), requests.end());
+            for (auto &m : missing) {
+                if (pending.insert(chunkKey(m.first, m.second)).second) {
+                    requests.push_back(m);
+                }
+            }
+            sort(requests.begin(), requests.end(), [cx, cy](auto &a, auto &b) {
+                return max(abs(a.first - cx), abs(a.second - cy)) > max(abs(b.first - cx), abs(b.second - cy));
+            });
+        }
+        queueSignal.notify_one();
+    }
+
+    // Blocks until every chunk around the tile is resident, e.g. before the first frame
+    void prefetch(int tileX, int tileY) {
+        update(tileX, tileY);
+        while (true) {
+            {
+                lock_guard<mutex> lock(queueMutex);
+                if (requests.empty() && pending.size() == loaded.size()) break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        update(tileX, tileY);
+    }
+
+    [[nodiscard]] size_t residentChunks() const {
+        return resident.size();
+    }
+
+    [[nodiscard]] size_t cachedChunks() const {
+        return cache.size();
+    }
+};
+
+#endif //RENEGADE_ENGINE_CHUNKEDTILES_H
@@ -0,0 +1,351 @@
+#ifndef RENEGADE_ENGINE_COOKEDLEVEL_H
+#define RENEGADE_ENGINE_COOKEDLEVEL_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <filesystem>
+#include "../config.hpp"
+#include "MappedFile.h"
+#include "Hash.h"
+#include "TileGrid.h"
+#include "SolidGrid.h"
+#include "Light.h"
+#include "Level.h"
+
+using namespace std;
+
+// A level as written by renegade-cook: tile layers with ids already offset, in the engine's interleaved
+// cell layout, the solid grid, objects with interned names and the baked static lighting. The file is
+// mapped and the tiles and solid grid are used in place, so opening a level only costs page faults.
+// The files it was cooked from are listed with a hash of their contents, a level whose inputs changed
+// is loaded from them instead. Native byte order, cooked files are not meant to be shared between platforms.
+class CookedLevel {
+public:
+    static constexpr char MAGIC[4] = { 'R', 'C', 'L', 'V' };
+    static constexpr uint32_t VERSION = 2;
+    static constexpr size_t ALIGNMENT = 64;
+    // keeps the section sizes far from overflowing
+    static constexpr int MAX_SIZE = 1 << 20;
+    static constexpr int MAX_LIGHT_SUBDIVISION = 64;
+
+    struct Section {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t cellSize;
+        int32_t width;
+        int32_t height;
+        int32_t lightSubdivision;
+        int32_t globalLight;
+        uint32_t reserved;
+        // of the contents of the inputs, see hashInputs
+        uint64_t inputHash;
+        // paths of the files the level was cooked from, relative to the cooked file and each followed by a 0
+        Section inputs;
+        Section cells;
+        Section solid;
+        Section stringOffsets;
+        Section strings;
+        Section objects;
+        Section lightIntensity;
+        Section lightSamples;
+    };
+
+    struct Object {
+        uint32_t name;
+        uint32_t type;
+        float x;
+        float y;
+        uint8_t color[4];
+    };
+
+    using Cell = TileCell<Config::TileIdType>;
+private:
+    MappedFile file;
+    Header header {};
+    string directory;
+
+    [[nodiscard]] bool isValid(const Section &section, size_t expectedSize) const {
+        return section.offset % ALIGNMENT == 0 && section.offset + section.size <= file.size()
+            && section.size == expectedSize;
+    }
+
+    template<typename T>
+    [[nodiscard]] T *at(const Section &section) const {
+        return (T *)(file.data() + section.offset);
+    }
+
+    class Writer {
+    private:
+        vector<unsigned char> buffer;
+    public:
+        Writer() : buffer(sizeof(Header), 0) {}
+
+        Section add(const void *data, size_t size) {
+            buffer.resize((buffer.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, 0);
+            Section section { buffer.size(), size };
+            buffer.insert(buffer.end(), (const unsigned char *)data, (const unsigned char *)data + size);
+            return section;
+        }
+
+        template<typename T>
+        Section add(const vector<T> &data) {
+            return add(data.data(), data.size() * sizeof(T));
+        }
+
+        void setHeader(const Header &header) {
+            memcpy(buffer.data(), &header, sizeof(Header));
+        }
+
+        [[nodiscard]] const vector<unsigned char> &getBuffer() const {
+            return buffer;
+        }
+    };
+public:
+    explicit CookedLevel(const string &path) : file(path), directory(filesystem::path(path).parent_path().string()) {
+        if (!file.isOpen()) throw runtime_error("Could not open cooked level " + path);
+        if (file.size() < sizeof(Header)) throw runtime_error("Invalid cooked level " + path);
+        memcpy(&header, file.data(), sizeof(Header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) throw runtime_error("Invalid cooked level " + path);
+        if (header.version != VERSION || header.cellSize != sizeof(Cell)) {
+            throw runtime_error("Cooked level " + path + " was made by a different engine version, cook it again");
+        }
+        bool valid = header.width > 0 && header.width <= MAX_SIZE && header.height > 0 && header.height <= MAX_SIZE
+            && header.lightSubdivision > 0 && header.lightSubdivision <= MAX_LIGHT_SUBDIVISION;
+        if (!valid) throw runtime_error("Invalid cooked level " + path);
+        size_t tiles = (size_t)header.width * (size_t)header.height;
+        size_t samples = ((size_t)header.width * (size_t)header.lightSubdivision + 1)
+            * ((size_t)header.height * (size_t)header.lightSubdivision + 1);
+        valid = isValid(header.cells, tiles * sizeof(Cell))
+            && isValid(header.solid, (size_t)SolidGrid::wordsPerRow(header.width) * header.height * sizeof(uint64_t))
+            && isValid(header.lightIntensity, tiles * sizeof(uint8_t))
+            && isValid(header.lightSamples, samples * sizeof(LightColor))
+            && isValid(header.objects, header.objects.size - header.objects.size % sizeof(Object))
+            && isValid(header.stringOffsets, header.stringOffsets.size - header.stringOffsets.size % sizeof(uint32_t))
+            && isValid(header.strings, header.strings.size)
+            && isValid(header.inputs, header.inputs.size);
+        if (!valid) throw runtime_error("Invalid cooked level " + path);
+    }
+
+    // Where renegade-cook puts the cooked version of a Tiled level
+    static string cookedPath(const string &levelPath) {
+        return filesystem::path(levelPath).replace_extension(".rlevel").string();
+    }
+
+    // Hash of the paths and contents of the files a level is cooked from. Missing files hash differently
+    // from empty ones.
+    static uint64_t hashInputs(const string &directory, const vector<string> &inputs) {
+        Hash hash;
+        for (auto &input : inputs) {
+            hash.add(input.data(), input.size() + 1);
+            error_code error;
+            auto path = filesystem::path(directory) / input;
+            bool exists = filesystem::exists(path, error);
+            hash.add(exists);
+            if (!exists) continue;
+            MappedFile contents(path.string());
+            uint64_t size = contents.size();
+            hash.add(size);
+            if (contents.isOpen()) hash.add(contents.data(), contents.size());
+        }
+        return hash.get();
+    }
+
+    // Opens the cooked version of a level, if there is one that was cooked from the files as they are now.
+    // Costs a read of the inputs, far less than parsing them. Without any of the inputs around the cooked
+    // level is used as it is.
+    static shared_ptr<CookedLevel> open(const string &levelPath) {
+        auto path = cookedPath(levelPath);
+        error_code error;
+        if (!Config::INTERLEAVED_TILES) {
+            cout << "WARNING: cooked levels need interleaved tiles, loading " << levelPath << " instead" << endl;
+            return nullptr;
+        }
+        if (!filesystem::exists(path, error)) return nullptr;
+        shared_ptr<CookedLevel> level;
+        try {
+            level = make_shared<CookedLevel>(path);
+        } catch (runtime_error &e) {
+            cout << "WARNING: " << e.what() << endl;
+            return nullptr;
+        }
+        auto inputs = level->getInputs();
+        bool anyInput = any_of(inputs.begin(), inputs.end(), [&](const string &input) {
+            return filesystem::exists(filesystem::path(level->directory) / input, error);
+        });
+        if (anyInput && hashInputs(level->directory, inputs) != level->header.inputHash) {
+            cout << "WARNING: " << path << " was cooked from other versions of its files, run renegade-cook again" << endl;
+            return nullptr;
+        }
+        return level;
+    }
+
+    // Cooks a fully loaded (not streamed) map with its objects and baked lighting into a file. Inputs are
+    // the files the map was loaded from, a change to any of them makes open ignore the file.
+    template<class CookedMap>
+    static size_t write(const string &path, CookedMap &map, const vector<GameObject> &objects, const vector<string> &inputPaths) {
+        if (map.isStreaming()) throw runtime_error("Streamed maps can't be cooked");
+        int width = map.getWidth();
+        int height = map.getHeight();
+        auto &tiles = map.getTiles();
+        auto &solid = map.getSolidGrid();
+        auto &lightmap = map.getLightmap();
+
+        vector<Cell> cells(tiles.size());
+        for (size_t i = 0; i < cells.size(); i++) {
+            cells[i] = tiles.cell((int)i);
+        }
+
+        auto directory = filesystem::path(path).parent_path();
+        vector<string> inputs;
+        vector<char> inputList;
+        for (auto &input : inputPaths) {
+            error_code error;
+            auto relative = filesystem::relative(input, directory.empty() ? "." : directory, error);
+            inputs.push_back(error ? filesystem::absolute(input).string() : relative.string());
+            inputList.insert(inputList.end(), inputs.back().begin(), inputs.back().end());
+            inputList.push_back('\0');
+        }
+
+        vector<uint32_t> stringOffsets;
+        vector<char> strings;
+        unordered_map<string, uint32_t> interned;
+        auto intern = [&](const string &value) {
+            auto found = interned.find(value);
+            if (found != interned.end()) return found->second;
+            auto index = (uint32_t)stringOffsets.size();
+            stringOffsets.push_back((uint32_t)strings.size());
+            strings.insert(strings.end(), value.begin(), value.end());
+            strings.push_back('\0');
+            interned[value] = index;
+            return index;
+        };
+        vector<Object> cookedObjects;
+        cookedObjects.reserve(objects.size());
+        for (auto &obj : objects) {
+            cookedObjects.push_back({
+                intern(obj.name),
+                intern(obj.type),
+                obj.position.x,
+                obj.position.y,
+                { obj.color.r, obj.color.g, obj.color.b, obj.color.a }
+            });
+        }
+
+        Writer writer;
+        Header header {};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.cellSize = sizeof(Cell);
+        header.width = width;
+        header.height = height;
+        header.lightSubdivision = lightmap.getSubdivision();
+        header.globalLight = lightmap.getGlobalLight();
+        header.inputHash = hashInputs(directory.string(), inputs);
+        header.inputs = writer.add(inputList);
+        header.cells = writer.add(cells);
+        header.solid = writer.add(solid.data(), solid.wordCount() * sizeof(uint64_t));
+        header.stringOffsets = writer.add(stringOffsets);
+        header.strings = writer.add(strings);
+        header.objects = writer.add(cookedObjects);
+        header.lightIntensity = writer.add(lightmap.getIntensities());
+        header.lightSamples = writer.add(lightmap.getSamples());
+        writer.setHeader(header);
+
+        auto &buffer = writer.getBuffer();
+        ofstream out(path, ios::binary | ios::trunc);
+        if (!out || !out.write((const char *)buffer.data(), (streamsize)buffer.size())) {
+            throw runtime_error("Could not write cooked level " + path);
+        }
+        return buffer.size();
+    }
+
+    [[nodiscard]] vector<GameObject> getObjects() const {
+        auto offsets = at<const uint32_t>(header.stringOffsets);
+        size_t stringCount = header.stringOffsets.size / sizeof(uint32_t);
+        auto strings = at<const char>(header.strings);
+        auto text = [&](uint32_t index) {
+            if (index >= stringCount || offsets[index] >= header.strings.size) return string();
+            const char *first = strings + offsets[index];
+            auto end = (const char *)memchr(first, '\0', header.strings.size - offsets[index]);
+            return end != nullptr ? string(first, end) : string();
+        };
+        auto objects = at<const Object>(header.objects);
+        size_t count = header.objects.size / sizeof(Object);
+        vector<GameObject> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            auto &obj = objects[i];
+            result.push_back({
+                text(obj.name),
+                text(obj.type),
+                Vector2 { obj.x, obj.y },
+                Color { obj.color[0], obj.color[1], obj.color[2], obj.color[3] }
+            });
+        }
+        return result;
+    }
+
+    // Paths of the files the level was cooked from, relative to the cooked file
+    [[nodiscard]] vector<string> getInputs() const {
+        vector<string> inputs;
+        auto list = at<const char>(header.inputs);
+        for (size_t i = 0; i < header.inputs.size;) {
+            auto end = (const char *)memchr(list + i, '\0', header.inputs.size - i);
+            if (end == nullptr) break;
+            inputs.emplace_back(list + i, end);
+            i = end - list + 1;
+        }
+        return inputs;
+    }
+
+    // Tiles and solid grid in the mapped file, changes stay in memory
+    [[nodiscard]] Cell *getCells() const {
+        return at<Cell>(header.cells);
+    }
+
+    [[nodiscard]] uint64_t *getSolidWords() const {
+        return at<uint64_t>(header.solid);
+    }
+
+    [[nodiscard]] vector<uint8_t> getLightIntensities() const {
+        auto data = at<const uint8_t>(header.lightIntensity);
+        return { data, data + header.lightIntensity.size / sizeof(uint8_t) };
+    }
+
+    [[nodiscard]] vector<LightColor> getLightSamples() const {
+        auto data = at<const LightColor>(header.lightSamples);
+        return { data, data + header.lightSamples.size / sizeof(LightColor) };
+    }
+
+    [[nodiscard]] int getWidth() const {
+        return header.width;
+    }
+
+    [[nodiscard]] int getHeight() const {
+        return header.height;
+    }
+
+    [[nodiscard]] int getLightSubdivision() const {
+        return header.lightSubdivision;
+    }
+
+    [[nodiscard]] int getGlobalLight() const {
+        return header.globalLight;
+    }
+
+    [[nodiscard]] size_t getSize() const {
+        return file.size();
+    }
+};
+
+#endif //RENEGADE_ENGINE_COOKEDLEVEL_H
@@ -0,0 +1,141 @@
+#ifndef RENEGADE_ENGINE_CSVLEVEL_H
+#define RENEGADE_ENGINE_CSVLEVEL_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <filesystem>
+#include <iostream>
+#include "MappedFile.h"
+#include "Level.h"
+
+using namespace std;
+
+// A level made of Tiled's CSV layer export: <name>_walls.csv, <name>_floor.csv and <name>_ceiling.csv,
+// one row of tile ids per line with -1 for empty tiles (the id offset is already applied). The files
+// are mapped and parsed straight into the map by Map::loadLayers, the same way as a Tiled level.
+// CSV has no objects, they come from the Tiled map <name>.json next to the layers when there is one.
+class CsvLevel {
+private:
+    string basePath;
+    unique_ptr<MappedFile> walls;
+    unique_ptr<MappedFile> floor;
+    unique_ptr<MappedFile> ceiling;
+    int width { 0 };
+    int height { 0 };
+
+    static unique_ptr<MappedFile> open(const string &path) {
+        auto file = make_unique<MappedFile>(path);
+        if (!file->isOpen()) throw runtime_error("Could not open layer " + path);
+        return file;
+    }
+
+    [[nodiscard]] const MappedFile &layerFile(const string &layerName) const {
+        if (layerName == "walls") return *walls;
+        if (layerName == "floor") return *floor;
+        if (layerName == "ceiling") return *ceiling;
+        throw runtime_error("Could not find layer " + layerName);
+    }
+
+    // Calls set(index, id) for the values of a layer, at most count of them. Returns how many there are.
+    template<typename Setter>
+    static size_t parse(const char *c, const char *end, size_t count, const string &layerName, Setter set) {
+        size_t index = 0;
+        while (c < end) {
+            while (c < end && (*c == ',' || *c == '\n' || *c == '\r' || *c == ' ')) c++;
+            if (c == end) break;
+            bool negative = *c == '-';
+            c += negative;
+            // one compare per digit, anything below '0' wraps around
+            unsigned digit = c < end ? (unsigned)(*c - '0') : 10;
+            if (digit > 9) throw runtime_error("Invalid " + layerName + " data");
+            int value = (int)digit;
+            while (++c < end && (digit = (unsigned)(*c - '0')) <= 9) {
+                if (value > 100000000) throw runtime_error("Invalid " + layerName + " data");
+                value = value * 10 + (int)digit;
+            }
+            if (index < count) set((int)index, negative ? -value : value);
+            index++;
+        }
+        return index;
+    }
+public:
+    // Any of the layer files or the common part of their names
+    explicit CsvLevel(const string &path) {
+        this->basePath = path;
+        for (auto &suffix : { "_walls.csv", "_floor.csv", "_ceiling.csv" }) {
+            size_t length = strlen(suffix);
+            if (path.size() > length && path.compare(path.size() - length, length, suffix) == 0) {
+                this->basePath = path.substr(0, path.size() - length);
+            }
+        }
+        this->walls = open(basePath + "_walls.csv");
+        this->floor = open(basePath + "_floor.csv");
+        this->ceiling = open(basePath + "_ceiling.csv");
+
+        // size from the walls, values in the first line and lines with values. Blank lines, e.g. after
+        // the last row or from "\r\n\r\n", are no rows.
+        auto begin = (const char *)walls->data();
+        auto end = begin + walls->size();
+        for (auto line = begin; line < end;) {
+            auto lineEnd = std::find(line, end, '\n');
+            if (std::find_if(line, lineEnd, [](char c) { return c != ' ' && c != '\r'; }) != lineEnd) {
+                if (this->height == 0) this->width = (int)std::count(line, lineEnd, ',') + 1;
+                this->height++;
+            }
+            line = lineEnd + 1;
+        }
+        if (width <= 0 || height <= 0) throw runtime_error("Invalid walls data");
+    }
+
+    static bool isCsvLevel(const string &path) {
+        return path.size() > 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    }
+
+    [[nodiscard]] tson::Vector2<int> getSize() const {
+        return { width, height };
+    }
+
+    [[nodiscard]] bool isInfinite() const {
+        return false;
+    }
+
+    [[nodiscard]] string getObjectsPath() const {
+        return basePath + ".json";
+    }
+
+    [[nodiscard]] vector<GameObject> getObjects() const {
+        if (!filesystem::exists(getObjectsPath())) {
+            cout << "WARNING: level without objects, " << getObjectsPath() << " not found" << endl;
+            return {};
+        }
+        return Level(getObjectsPath()).getObjects();
+    }
+
+    [[nodiscard]] vector<string> getInputPaths() const {
+        vector<string> paths { basePath + "_walls.csv", basePath + "_floor.csv", basePath + "_ceiling.csv" };
+        if (filesystem::exists(getObjectsPath())) paths.push_back(getObjectsPath());
+        return paths;
+    }
+
+    template<typename Setter>
+    void readLayerData(const string &layerName, Setter set) const {
+        auto &file = layerFile(layerName);
+        auto begin = (const char *)file.data();
+        size_t size = (size_t)width * height;
+        if (parse(begin, begin + file.size(), size, layerName, set) != size) {
+            throw runtime_error("Invalid " + layerName + " data");
+        }
+    }
+
+    vector<int> getLayerData(const string &layerName) const {
+        vector<int> data((size_t)width * height);
+        readLayerData(layerName, [&](int i, int id) { data[i] = id; });
+        return data;
+    }
+};
+
+#endif //RENEGADE_ENGINE_CSVLEVEL_H
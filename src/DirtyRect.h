@@ -0,0 +1,42 @@
+#ifndef RENEGADE_ENGINE_DIRTYRECT_H
+#define RENEGADE_ENGINE_DIRTYRECT_H
+
+#include <algorithm>
+
+// Tile rectangle, x1 and y1 exclusive
+struct DirtyRect {
+    int x0 { 0 };
+    int y0 { 0 };
+    int x1 { 0 };
+    int y1 { 0 };
+
+    [[nodiscard]] bool isEmpty() const {
+        return x1 <= x0 || y1 <= y0;
+    }
+
+    [[nodiscard]] bool contains(int x, int y) const {
+        return x >= x0 && x < x1 && y >= y0 && y < y1;
+    }
+
+    [[nodiscard]] bool intersects(const DirtyRect &other) const {
+        return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1;
+    }
+
+    [[nodiscard]] long long area() const {
+        return isEmpty() ? 0 : (long long)(x1 - x0) * (y1 - y0);
+    }
+
+    void merge(const DirtyRect &other) {
+        if (other.isEmpty()) return;
+        if (isEmpty()) {
+            *this = other;
+            return;
+        }
+        x0 = std::min(x0, other.x0);
+        y0 = std::min(y0, other.y0);
+        x1 = std::max(x1, other.x1);
+        y1 = std::max(y1, other.y1);
+    }
+};
+
+#endif //RENEGADE_ENGINE_DIRTYRECT_H
@@ -0,0 +1,86 @@
+#ifndef RENEGADE_ENGINE_DISTANCEFIELD_H
+#define RENEGADE_ENGINE_DISTANCEFIELD_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "SolidGrid.h"
+
+using namespace std;
+
+// Chebyshev distance from every tile to the nearest solid tile of a SolidGrid, capped at 255. Solid
+// tiles and everything outside the map are 0. A tile at distance d has only free tiles in the square of
+// radius d - 1 around it, which is what lets a ray jump over open space.
+class DistanceField {
+public:
+    static constexpr int MAX_DISTANCE = 255;
+private:
+    const SolidGrid &grid;
+    int width;
+    int height;
+    vector<uint8_t> distances;
+    // upper bound of every distance in the field, limits how far a wall change can reach
+    int maxDistance { 0 };
+
+    [[nodiscard]] inline int at(int x, int y) const {
+        if ((unsigned)x >= (unsigned)width || (unsigned)y >= (unsigned)height) return 0;
+        return distances[y * width + x];
+    }
+
+    // Two pass chamfer transform of [x0, x1) x [y0, y1), the tiles around the rect are taken as they are
+    void transform(int x0, int y0, int x1, int y1) {
+        for (int y = y0; y < y1; y++) {
+            uint8_t *row = &distances[y * width];
+            std::fill(row + x0, row + x1, (uint8_t)MAX_DISTANCE);
+            // 64 tiles at a time, open rows cost a few word tests
+            for (int x = grid.findSolid(y, x0, x1); x < x1; x = grid.findSolid(y, x + 1, x1)) {
+                row[x] = 0;
+            }
+        }
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                uint8_t &d = distances[y * width + x];
+                if (d == 0) continue;
+                int n = std::min({ at(x - 1, y), at(x - 1, y - 1), at(x, y - 1), at(x + 1, y - 1) }) + 1;
+                if (n < d) d = (uint8_t)n;
+            }
+        }
+        int localMax = 0;
+        for (int y = y1 - 1; y >= y0; y--) {
+            for (int x = x1 - 1; x >= x0; x--) {
+                uint8_t &d = distances[y * width + x];
+                if (d != 0) {
+                    int n = std::min({ at(x + 1, y), at(x + 1, y + 1), at(x, y + 1), at(x - 1, y + 1) }) + 1;
+                    if (n < d) d = (uint8_t)n;
+                }
+                localMax = std::max(localMax, (int)d);
+            }
+        }
+        maxDistance = std::max(maxDistance, localMax);
+    }
+public:
+    explicit DistanceField(const SolidGrid &grid) : grid(grid) {
+        this->width = grid.getWidth();
+        this->height = grid.getHeight();
+        this->distances = vector<uint8_t>((size_t)width * height, 0);
+        this->transform(0, 0, width, height);
+    }
+
+    [[nodiscard]] inline int distance(int x, int y) const {
+        return at(x, y);
+    }
+
+    // Recalculates the field after the grid changed in [x0, x1) x [y0, y1). Only tiles closer to the
+    // change than the largest distance in the field can be affected.
+    void update(int x0, int y0, int x1, int y1) {
+        int reach = maxDistance + 1;
+        this->transform(std::max(x0 - reach, 0), std::max(y0 - reach, 0),
+                        std::min(x1 + reach, width), std::min(y1 + reach, height));
+    }
+
+    [[nodiscard]] size_t memoryFootprint() const {
+        return distances.capacity() * sizeof(uint8_t);
+    }
+};
+
+#endif //RENEGADE_ENGINE_DISTANCEFIELD_H
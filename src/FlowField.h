@@ -0,0 +1,132 @@
+#ifndef RENEGADE_ENGINE_FLOWFIELD_H
+#define RENEGADE_ENGINE_FLOWFIELD_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "SolidGrid.h"
+
+using namespace std;
+
+// Path costs from every free tile around a target to the target, and the first step of a shortest path
+// from there. Everything chasing the same target reads its next step from here instead of searching its
+// own path, so the work per target move is one pass over the tiles in range no matter how many chase it.
+// Moves are the ones of the pathfinder with diagonal movement: 8 directions, straight steps cost 10,
+// diagonal ones 14, a step needs a free destination.
+class FlowField {
+public:
+    static constexpr uint32_t UNREACHED = UINT32_MAX;
+private:
+    static constexpr uint8_t NO_STEP = 0xFF;
+    static constexpr int STEP_X[8] = { 0, 1, 0, -1, -1, 1, -1, 1 };
+    static constexpr int STEP_Y[8] = { 1, 0, -1, 0, -1, 1, 1, -1 };
+    static constexpr uint32_t STEP_COST[8] = { 10, 10, 10, 10, 14, 14, 14, 14 };
+
+    const SolidGrid &grid;
+    // tiles further away from the target than this (on either axis) are not in the field
+    int range;
+    int targetX { -1 };
+    int targetY { -1 };
+    unsigned long long gridVersion { 0 };
+    // the window of tiles around the target the field covers
+    int originX { 0 };
+    int originY { 0 };
+    int windowWidth { 0 };
+    int windowHeight { 0 };
+    vector<uint32_t> costs;
+    // direction of the next step toward the target, NO_STEP at the target and where it can't be reached
+    vector<uint8_t> steps;
+    // open tiles by cost, steps cost 10 or 14 so 15 buckets in a ring are enough
+    vector<int> buckets[15];
+
+    // the window has a frame of one tile around it, so that neighbors never need a bounds check
+    [[nodiscard]] inline int index(int x, int y) const {
+        x -= originX;
+        y -= originY;
+        if ((unsigned)x >= (unsigned)windowWidth || (unsigned)y >= (unsigned)windowHeight) return -1;
+        return (y + 1) * (windowWidth + 2) + x + 1;
+    }
+
+    // Dijkstra outward from the target, a tile reached from a neighbor steps back to that neighbor. Walls
+    // and the frame start out with cost 0, as if they were done already, so the search never enters them.
+    void integrate() {
+        originX = std::max(targetX - range, 0);
+        originY = std::max(targetY - range, 0);
+        windowWidth = std::max(std::min(targetX + range + 1, grid.getWidth()) - originX, 0);
+        windowHeight = std::max(std::min(targetY + range + 1, grid.getHeight()) - originY, 0);
+        int stride = windowWidth + 2;
+        costs.assign((size_t)stride * (windowHeight + 2), 0);
+        steps.assign(costs.size(), NO_STEP);
+        for (int y = 0; y < windowHeight; y++) {
+            uint32_t *row = &costs[(size_t)(y + 1) * stride + 1];
+            for (int x = 0; x < windowWidth; x++) {
+                if (!grid.isSolid(originX + x, originY + y)) row[x] = UNREACHED;
+            }
+        }
+        int start = index(targetX, targetY);
+        if (start < 0 || costs[start] != UNREACHED) return;
+
+        int offsets[8];
+        for (int i = 0; i < 8; i++) {
+            offsets[i] = STEP_Y[i] * stride + STEP_X[i];
+        }
+        costs[start] = 0;
+        buckets[0].push_back(start);
+        size_t pending = 1;
+        for (uint32_t cost = 0; pending > 0; cost++) {
+            auto &bucket = buckets[cost % 15];
+            for (int current : bucket) {
+                pending--;
+                if (costs[current] != cost) continue;
+                for (int i = 0; i < 8; i++) {
+                    int from = current + offsets[i];
+                    uint32_t total = cost + STEP_COST[i];
+                    if (total >= costs[from]) continue;
+                    costs[from] = total;
+                    // the opposite direction, from the neighbor back to this tile
+                    steps[from] = (uint8_t)(i < 4 ? (i + 2) % 4 : i ^ 1);
+                    buckets[total % 15].push_back(from);
+                    pending++;
+                }
+            }
+            bucket.clear();
+        }
+    }
+public:
+    explicit FlowField(const SolidGrid &grid, int range) : grid(grid), range(range) {}
+
+    // Moves the target. The field is recalculated when the target moved to another tile or the walls
+    // changed since the last time, returns whether it was.
+    bool setTarget(int x, int y) {
+        if (x == targetX && y == targetY && grid.getVersion() == gridVersion) return false;
+        this->targetX = x;
+        this->targetY = y;
+        this->gridVersion = grid.getVersion();
+        this->integrate();
+        return true;
+    }
+
+    // The tile to step to from a tile toward the target, false on the target and where the field does
+    // not reach
+    bool next(int x, int y, int &nextX, int &nextY) const {
+        int i = index(x, y);
+        if (i < 0 || steps[i] == NO_STEP) return false;
+        nextX = x + STEP_X[steps[i]];
+        nextY = y + STEP_Y[steps[i]];
+        return true;
+    }
+
+    // Cost of the path from a tile to the target, UNREACHED for walls and tiles the field does not reach
+    [[nodiscard]] uint32_t cost(int x, int y) const {
+        int i = index(x, y);
+        if (i < 0) return UNREACHED;
+        if (x == targetX && y == targetY) return costs[i] == 0 && !grid.isSolid(x, y) ? 0 : UNREACHED;
+        return steps[i] != NO_STEP ? costs[i] : UNREACHED;
+    }
+
+    [[nodiscard]] size_t memoryFootprint() const {
+        return costs.capacity() * sizeof(uint32_t) + steps.capacity() * sizeof(uint8_t);
+    }
+};
+
+#endif //RENEGADE_ENGINE_FLOWFIELD_H
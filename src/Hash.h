@@ -0,0 +1,30 @@
+#ifndef RENEGADE_ENGINE_HASH_H
+#define RENEGADE_ENGINE_HASH_H
+
+#include <cstdint>
+#include <cstddef>
+
+// FNV-1a, for cache keys
+class Hash {
+private:
+    uint64_t value { 14695981039346656037ull };
+public:
+    void add(const void *data, size_t size) {
+        auto bytes = (const unsigned char *)data;
+        for (size_t i = 0; i < size; i++) {
+            value ^= bytes[i];
+            value *= 1099511628211ull;
+        }
+    }
+
+    template<typename T>
+    void add(const T &data) {
+        add(&data, sizeof(T));
+    }
+
+    [[nodiscard]] uint64_t get() const {
+        return value;
+    }
+};
+
+#endif //RENEGADE_ENGINE_HASH_H
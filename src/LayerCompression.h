@@ -0,0 +1,183 @@
+#ifndef RENEGADE_ENGINE_LAYERCOMPRESSION_H
+#define RENEGADE_ENGINE_LAYERCOMPRESSION_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <fstream>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "../lib/Tileson.h"
+
+#ifdef RENEGADE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef RENEGADE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef RENEGADE_LZMA
+#include <lzma.h>
+#endif
+
+using namespace std;
+
+// Base64 tile layer data and the compressions Tiled writes (zlib, gzip, zstd), plus lzma. Which
+// compressions are available depends on the libraries CMake found (RENEGADE_ZLIB, RENEGADE_ZSTD,
+// RENEGADE_LZMA), levels using a missing one fail to load with an error.
+namespace LayerCompression {
+    static inline vector<uint8_t> decodeBase64(const char *text, size_t length) {
+        static const auto table = [] {
+            array<int8_t, 256> values {};
+            values.fill(-1);
+            const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int i = 0; i < 64; i++) values[(unsigned char)alphabet[i]] = (int8_t)i;
+            return values;
+        }();
+        vector<uint8_t> bytes;
+        bytes.reserve(length / 4 * 3);
+        uint32_t bits = 0;
+        int count = 0;
+        for (size_t i = 0; i < length; i++) {
+            if (text[i] == '=') break;
+            // whitespace and json escapes (\/)
+            int value = table[(unsigned char)text[i]];
+            if (value < 0) continue;
+            bits = (bits << 6) | (uint32_t)value;
+            if (++count == 4) {
+                bytes.push_back((uint8_t)(bits >> 16));
+                bytes.push_back((uint8_t)(bits >> 8));
+                bytes.push_back((uint8_t)bits);
+                bits = 0;
+                count = 0;
+            }
+        }
+        if (count == 3) {
+            bytes.push_back((uint8_t)(bits >> 10));
+            bytes.push_back((uint8_t)(bits >> 2));
+        } else if (count == 2) {
+            bytes.push_back((uint8_t)(bits >> 4));
+        }
+        return bytes;
+    }
+
+    static inline bool isSupported(const string &compression) {
+        if (compression.empty()) return true;
+#ifdef RENEGADE_ZLIB
+        if (compression == "zlib" || compression == "gzip") return true;
+#endif
+#ifdef RENEGADE_ZSTD
+        if (compression == "zstd") return true;
+#endif
+#ifdef RENEGADE_LZMA
+        if (compression == "lzma") return true;
+#endif
+        return false;
+    }
+
+    // Decompresses a whole stream, expectedSize is where the output starts, it grows as needed
+    static inline vector<uint8_t> decompress(const string &compression, const uint8_t *data, size_t size, size_t expectedSize = 0) {
+        if (compression.empty()) return { data, data + size };
+        vector<uint8_t> out(std::max(expectedSize, size * 4) + 1);
+        size_t written = 0;
+        // unused when the build has no codec
+        [[maybe_unused]] auto finish = [&](bool complete) -> vector<uint8_t> {
+            if (!complete) throw runtime_error("Corrupt " + compression + " layer data");
+            out.resize(written);
+            return std::move(out);
+        };
+#ifdef RENEGADE_ZLIB
+        if (compression == "zlib" || compression == "gzip") {
+            z_stream stream {};
+            // 15 + 32 detects zlib and gzip headers
+            if (inflateInit2(&stream, 15 + 32) != Z_OK) throw runtime_error("Could not start zlib");
+            stream.next_in = (Bytef *)data;
+            stream.avail_in = (uInt)size;
+            int result = Z_OK;
+            while (result == Z_OK) {
+                if (written == out.size()) out.resize(out.size() * 2);
+                stream.next_out = out.data() + written;
+                stream.avail_out = (uInt)(out.size() - written);
+                result = inflate(&stream, Z_NO_FLUSH);
+                written = out.size() - stream.avail_out;
+            }
+            inflateEnd(&stream);
+            return finish(result == Z_STREAM_END);
+        }
+#endif
+#ifdef RENEGADE_ZSTD
+        if (compression == "zstd") {
+            auto context = ZSTD_createDCtx();
+            ZSTD_inBuffer input { data, size, 0 };
+            size_t result;
+            while (true) {
+                if (written == out.size()) out.resize(out.size() * 2);
+                ZSTD_outBuffer output { out.data(), out.size(), written };
+                result = ZSTD_decompressStream(context, &output, &input);
+                written = output.pos;
+                // 0 once the frame is complete, input used up with room left means it is truncated
+                if (result == 0 || ZSTD_isError(result) || (input.pos == input.size && written < out.size())) break;
+            }
+            ZSTD_freeDCtx(context);
+            return finish(result == 0);
+        }
+#endif
+#ifdef RENEGADE_LZMA
+        if (compression == "lzma") {
+            lzma_stream stream = LZMA_STREAM_INIT;
+            if (lzma_auto_decoder(&stream, UINT64_MAX, 0) != LZMA_OK) throw runtime_error("Could not start lzma");
+            stream.next_in = data;
+            stream.avail_in = size;
+            lzma_ret result = LZMA_OK;
+            while (result == LZMA_OK) {
+                if (written == out.size()) out.resize(out.size() * 2);
+                stream.next_out = out.data() + written;
+                stream.avail_out = out.size() - written;
+                result = lzma_code(&stream, LZMA_FINISH);
+                written = out.size() - stream.avail_out;
+            }
+            lzma_end(&stream);
+            return finish(result == LZMA_STREAM_END);
+        }
+#endif
+        throw runtime_error("Unsupported layer compression " + compression);
+    }
+
+    // The same for Tileson, which needs it for layers it decodes itself (chunks of infinite maps)
+    class TilesonDecompressor : public tson::IDecompressor<std::string_view, std::string> {
+    private:
+        string compression;
+    public:
+        explicit TilesonDecompressor(string compression) : compression(std::move(compression)) {}
+
+        [[nodiscard]] const std::string &name() const override {
+            return compression;
+        }
+
+        std::string decompress(const std::string_view &input) override {
+            // layers the index took the data from
+            if (input.empty()) return {};
+            auto bytes = LayerCompression::decompress(compression, (const uint8_t *)input.data(), input.size());
+            return { bytes.begin(), bytes.end() };
+        }
+
+        std::string decompressFile(const fs::path &path) override {
+            ifstream file(path, ios::binary);
+            string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+            return decompress(data.data(), data.size());
+        }
+
+        std::string decompress(const void *data, size_t size) override {
+            return decompress(std::string_view((const char *)data, size));
+        }
+    };
+
+    static inline void addTo(tson::DecompressorContainer &container) {
+        for (auto &compression : { "zlib", "gzip", "zstd", "lzma" }) {
+            if (isSupported(compression)) container.add<TilesonDecompressor>(string(compression));
+        }
+    }
+}
+
+#endif //RENEGADE_ENGINE_LAYERCOMPRESSION_H
@@ -7,7 +7,15 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <raylib.h>
 #include "../lib/Tileson.h"
+#include "ChunkedTiles.h"
+#include "TiledLayerIndex.h"
+#include "LayerCompression.h"
 
 using namespace std;
 
@@ -15,15 +23,181 @@ struct GameObject {
     string name;
     string type;
     Vector2 position;
+    Color color { 255, 255, 255, 255 };
+};
+
+// Chunks of the walls, floor and ceiling layers of a Tiled map, finite or infinite. Infinite maps are
+// moved so their top left chunk starts at tile 0, 0. The layers stay in memory, finite ones copied and
+// infinite ones in the parsed map, so a streamed map still has to fit in RAM as a whole.
+class TilesonChunkSource : public ChunkSource {
+private:
+    struct LayerSource {
+        // finite maps
+        vector<uint32_t> data;
+        // infinite maps, gids of the Tiled chunks by their chunk coordinates
+        unordered_map<uint64_t, const vector<int> *> chunks;
+        // base64 chunks, which Tileson leaves undecoded
+        unordered_map<uint64_t, vector<int>> decoded;
+        int chunkWidth { 16 };
+        int chunkHeight { 16 };
+    };
+
+    LayerSource walls;
+    LayerSource floor;
+    LayerSource ceiling;
+    bool infinite;
+    int originX { 0 };
+    int originY { 0 };
+    int width { 0 };
+    int height { 0 };
+
+    static int floorDiv(int value, int divisor) {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+
+    static LayerSource createLayerSource(tson::Map &map, const TiledLayerIndex *index, const string &layerName) {
+        auto layer = map.getLayer(layerName);
+        if (layer == nullptr) throw runtime_error("Could not find layer " + layerName);
+        LayerSource source;
+        if (!map.isInfinite()) {
+            size_t size = (size_t)map.getSize().x * map.getSize().y;
+            if (index != nullptr && index->has(layerName)) {
+                source.data.resize(size, 0);
+                index->read(layerName, size, [&](int i, uint32_t gid) { source.data[i] = gid; });
+            } else {
+                source.data = layer->getData();
+                source.data.resize(size, 0);
+            }
+            return source;
+        }
+        for (auto &chunk : layer->getChunks()) {
+            source.chunkWidth = chunk.getSize().x;
+            source.chunkHeight = chunk.getSize().y;
+            int cx = floorDiv(chunk.getPosition().x, source.chunkWidth);
+            int cy = floorDiv(chunk.getPosition().y, source.chunkHeight);
+            auto key = chunkKey(cx, cy);
+            const vector<int> *data = &chunk.getData();
+            if (data->empty() && !chunk.getBase64Data().empty()) {
+                auto &base64 = chunk.getBase64Data();
+                auto bytes = LayerCompression::decodeBase64(base64.data(), base64.size());
+                bytes = LayerCompression::decompress(layer->getCompression(), bytes.data(), bytes.size(), (size_t)source.chunkWidth * source.chunkHeight * 4);
+                auto &gids = source.decoded[key];
+                gids.resize(bytes.size() / 4);
+                for (size_t i = 0; i < gids.size(); i++) {
+                    auto gid = &bytes[i * 4];
+                    gids[i] = (int)((uint32_t)gid[0] | (uint32_t)gid[1] << 8 | (uint32_t)gid[2] << 16 | (uint32_t)gid[3] << 24);
+                }
+                data = &gids;
+            }
+            if (data->size() < (size_t)source.chunkWidth * source.chunkHeight) {
+                throw runtime_error("Invalid chunk data in layer " + layerName);
+            }
+            source.chunks[key] = data;
+        }
+        return source;
+    }
+
+    // Tiled gid at a tile position of the map, 0 if there is none
+    [[nodiscard]] uint32_t gidAt(const LayerSource &layer, int x, int y) const {
+        if (!infinite) {
+            if (x < 0 || y < 0 || x >= width || y >= height) return 0;
+            return layer.data[y * width + x];
+        }
+        x += originX;
+        y += originY;
+        int cx = floorDiv(x, layer.chunkWidth);
+        int cy = floorDiv(y, layer.chunkHeight);
+        auto chunk = layer.chunks.find(chunkKey(cx, cy));
+        if (chunk == layer.chunks.end()) return 0;
+        int localX = x - cx * layer.chunkWidth;
+        int localY = y - cy * layer.chunkHeight;
+        return (uint32_t)(*chunk->second)[localY * layer.chunkWidth + localX];
+    }
+
+    // Same id offset as Level::getLayerData, flip flags are dropped. Ids the tile id type can't hold
+    // become empty tiles, this runs on the streaming thread and must not throw.
+    static Config::TileIdType toTileId(uint32_t gid) {
+        int id = (int)(gid & 0x1FFFFFFF) - 1;
+        if (id <= 0 || id > std::numeric_limits<Config::TileIdType>::max()) return 0;
+        return (Config::TileIdType)id;
+    }
+public:
+    // Layers the index has are read from it, Tileson has no data for them
+    explicit TilesonChunkSource(tson::Map &map, const TiledLayerIndex *index = nullptr) {
+        this->infinite = map.isInfinite();
+        this->walls = createLayerSource(map, index, "walls");
+        this->floor = createLayerSource(map, index, "floor");
+        this->ceiling = createLayerSource(map, index, "ceiling");
+        if (!infinite) {
+            this->width = map.getSize().x;
+            this->height = map.getSize().y;
+            return;
+        }
+        // bounds of all chunks of all layers
+        int minX = INT32_MAX, minY = INT32_MAX, maxX = INT32_MIN, maxY = INT32_MIN;
+        for (auto &name : { "walls", "floor", "ceiling" }) {
+            for (auto &chunk : map.getLayer(name)->getChunks()) {
+                minX = std::min(minX, chunk.getPosition().x);
+                minY = std::min(minY, chunk.getPosition().y);
+                maxX = std::max(maxX, chunk.getPosition().x + chunk.getSize().x);
+                maxY = std::max(maxY, chunk.getPosition().y + chunk.getSize().y);
+            }
+        }
+        if (minX > maxX) throw runtime_error("Infinite map without chunks");
+        this->originX = minX;
+        this->originY = minY;
+        this->width = maxX - minX;
+        this->height = maxY - minY;
+    }
+
+    bool load(int cx, int cy, Chunk &chunk) override {
+        int startX = cx * Chunk::SIZE;
+        int startY = cy * Chunk::SIZE;
+        if (startX >= width || startY >= height || startX + Chunk::SIZE <= 0 || startY + Chunk::SIZE <= 0) return false;
+        for (int y = 0; y < Chunk::SIZE; y++) {
+            for (int x = 0; x < Chunk::SIZE; x++) {
+                auto &cell = chunk.cells[(y << Chunk::SHIFT) | x];
+                cell.wall = toTileId(gidAt(walls, startX + x, startY + y));
+                cell.floor = toTileId(gidAt(floor, startX + x, startY + y));
+                cell.ceiling = toTileId(gidAt(ceiling, startX + x, startY + y));
+                cell.flags = cell.wall > 0 ? TileFlags::SOLID : 0;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] int getWidth() const {
+        return width;
+    }
+
+    [[nodiscard]] int getHeight() const {
+        return height;
+    }
 };
 
 class Level {
 private:
     std::unique_ptr<tson::Map> map;
+    // tile layer data, read from the map text instead of going through Tileson
+    std::unique_ptr<TiledLayerIndex> layerIndex;
+    string path;
 public:
-    Level(const string &mapPath) {
-        tson::Tileson t;
-        this->map = t.parse(mapPath);
+    Level(const string &mapPath) : path(mapPath) {
+        ifstream file(mapPath, ios::binary);
+        if (!file) throw runtime_error("Could not parse map " + mapPath);
+        try {
+            this->layerIndex = make_unique<TiledLayerIndex>(string(istreambuf_iterator<char>(file), istreambuf_iterator<char>()));
+        } catch (runtime_error &) {
+            throw runtime_error("Could not parse map " + mapPath);
+        }
+        auto json = make_unique<tson::Json11>();
+        // external tilesets are relative to the map
+        json->directory(filesystem::path(mapPath).parent_path());
+        tson::Tileson t(std::move(json));
+        // for the layers Tileson decodes itself
+        LayerCompression::addTo(*t.decompressors());
+        auto stripped = this->layerIndex->stripped();
+        this->map = t.parse(stripped.data(), stripped.size());
 
         if(map->getStatus() != tson::ParseStatus::OK) throw runtime_error("Could not parse map " + mapPath);
     }
@@ -32,16 +206,54 @@ public:
         return this->map->getSize();
     }
 
-    vector<int> getLayerData(const string &layerName) {
+    bool isInfinite() {
+        return this->map->isInfinite();
+    }
+
+    // The map file and its external tilesets
+    vector<string> getInputPaths() const {
+        vector<string> paths { this->path };
+        tson::Json11 json;
+        auto stripped = this->layerIndex->stripped();
+        if (!json.parse(stripped.data(), stripped.size())) return paths;
+        for (auto &tileset : json.array("tilesets")) {
+            if (tileset->count("source") == 0) continue;
+            auto source = (*tileset)["source"].get<std::string>();
+            paths.push_back((filesystem::path(this->path).parent_path() / source).string());
+        }
+        return paths;
+    }
+
+    // Tiles for a streamed map, the source reads from this level and must not outlive it
+    unique_ptr<TilesonChunkSource> createChunkSource() {
+        return make_unique<TilesonChunkSource>(*this->map, this->layerIndex.get());
+    }
+
+    // Calls set(index, tileId) for every tile of a layer, with the id offset fixed and flip flags dropped
+    template<typename Setter>
+    void readLayerData(const string &layerName, Setter set) {
         auto layer = map->getLayer(layerName);
         if (layer == nullptr) throw runtime_error("Could not find layer " + layerName);
-        // Fix id offsets
-        auto layerData = layer->getData();
-        for (auto &id : layerData) {
-            id = id -1;
+        size_t size = (size_t)map->getSize().x * map->getSize().y;
+        size_t count;
+        if (this->layerIndex->has(layerName)) {
+            count = this->layerIndex->read(layerName, size, [&](int i, uint32_t gid) {
+                set(i, (int)(gid & 0x1FFFFFFF) - 1);
+            });
+        } else {
+            auto &data = layer->getData();
+            count = data.size();
+            for (size_t i = 0; i < count && i < size; i++) {
+                set((int)i, (int)(data[i] & 0x1FFFFFFF) - 1);
+            }
         }
+        if (count != size) throw runtime_error("Invalid " + layerName + " data");
+    }
 
-        return (const vector<int> &) layerData;
+    vector<int> getLayerData(const string &layerName) {
+        vector<int> data((size_t)map->getSize().x * map->getSize().y);
+        readLayerData(layerName, [&](int i, int id) { data[i] = id; });
+        return data;
     }
 
     vector<GameObject> getObjects() {
@@ -52,10 +264,16 @@ public:
         result.reserve(objects.size());
         for (auto &obj : objects) {
             auto pos = obj.getPosition();
+            Color color { 255, 255, 255, 255 };
+            if (obj.getProperties().hasProperty("color")) {
+                auto c = obj.get<tson::Colori>("color");
+                color = Color { c.r, c.g, c.b, c.a };
+            }
             result.push_back({
                 obj.getName(),
                 obj.getType(),
-                Vector2 { (float)pos.x, (float)pos.y }
+                Vector2 { (float)pos.x, (float)pos.y },
+                color
             });
         }
         return result;
@@ -0,0 +1,210 @@
+#ifndef RENEGADE_ENGINE_LEVELLOADER_H
+#define RENEGADE_ENGINE_LEVELLOADER_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include "../config.hpp"
+#include "Level.h"
+#include "Map.h"
+#include "LightBake.h"
+#include "CookedLevel.h"
+#include "CsvLevel.h"
+
+using namespace std;
+
+// Everything a level needs before its first frame. Built without touching the GPU, so it can be
+// made on any thread.
+struct LoadedLevel {
+    string path;
+    // only kept for streamed maps, they read their chunks from the level
+    unique_ptr<Level> level;
+    unique_ptr<Map> map;
+    vector<GameObject> objects;
+
+    // Level an "exit" object leads to, its name is the level file relative to this one
+    [[nodiscard]] string exitAt(int tileX, int tileY) const {
+        for (auto &obj : objects) {
+            if (obj.type != "exit") continue;
+            if ((int)(obj.position.x / Config::TEXTURE_SIZE) == tileX && (int)(obj.position.y / Config::TEXTURE_SIZE) == tileY) {
+                return LoadedLevel::resolve(path, obj.name);
+            }
+        }
+        return "";
+    }
+
+    // The first exit of the level, the one worth preloading
+    [[nodiscard]] string nextLevel() const {
+        for (auto &obj : objects) {
+            if (obj.type == "exit") return LoadedLevel::resolve(path, obj.name);
+        }
+        return "";
+    }
+
+    // Textures the level's objects are drawn with, objects are named after their sprite
+    [[nodiscard]] vector<string> getTextureNames() const {
+        vector<string> names;
+        for (auto &obj : objects) {
+            if (!obj.name.empty() && std::find(names.begin(), names.end(), obj.name) == names.end()) names.push_back(obj.name);
+        }
+        return names;
+    }
+
+    static string resolve(const string &from, const string &to) {
+        return (filesystem::path(from).parent_path() / to).lexically_normal().string();
+    }
+};
+
+// Loads levels on a background thread while the main thread keeps presenting frames. One level is
+// loaded to be played next, another one can be preloaded in the meantime so that walking through an
+// exit is instant when the preload is done.
+class LevelLoader {
+private:
+    struct Job {
+        string path;
+        thread worker;
+        atomic<float> progress { 0.0f };
+        atomic<bool> finished { false };
+        mutex stageLock;
+        string stage;
+        unique_ptr<LoadedLevel> result;
+        exception_ptr error;
+
+        void report(float value, const string &name) {
+            {
+                lock_guard<mutex> guard(stageLock);
+                this->stage = name;
+            }
+            this->progress = value;
+        }
+    };
+
+    unique_ptr<Job> current;
+    unique_ptr<Job> preloaded;
+
+    static void run(Job &job) {
+        try {
+            auto loaded = make_unique<LoadedLevel>();
+            loaded->path = job.path;
+            job.report(0.0f, "Reading " + job.path);
+            if (auto cooked = CookedLevel::open(job.path)) {
+                // made by renegade-cook, mapped and used as is
+                loaded->objects = cooked->getObjects();
+                job.report(0.5f, "Building map");
+                loaded->map = make_unique<Map>(cooked);
+            } else if (CsvLevel::isCsvLevel(job.path)) {
+                CsvLevel level(job.path);
+                loaded->objects = level.getObjects();
+                job.report(0.4f, "Building map");
+                auto size = level.getSize();
+                loaded->map = make_unique<Map>(size.x, size.y, 0, Config::LIGHTMAP_SUBDIVISION);
+                loaded->map->loadLayers(level);
+                job.report(0.7f, "Lighting");
+                LightBake::loadOrBake(*loaded->map, loaded->objects, job.path);
+            } else {
+                auto level = make_unique<Level>(job.path);
+                loaded->objects = level->getObjects();
+                job.report(0.4f, "Building map");
+                if (level->isInfinite()) {
+                    // open world, tiles are streamed in chunks around the player. The level stays loaded as
+                    // the chunk source and solid, distance and light grids cover the whole map, so this keeps
+                    // the raycaster on a small working set but doesn't make the map any smaller in memory.
+                    auto chunkSource = level->createChunkSource();
+                    int width = chunkSource->getWidth();
+                    int height = chunkSource->getHeight();
+                    // the chunks only use the source once the map is streamed, until then it bakes the light
+                    ChunkSourceGrid tiles(*chunkSource, width);
+                    loaded->map = make_unique<Map>(width, height, make_unique<ChunkedTiles>(std::move(chunkSource)),
+                                                   0, Config::LIGHTMAP_SUBDIVISION);
+                    job.report(0.7f, "Lighting");
+                    LightBake::loadOrBake(loaded->map->getLightmap(), tiles, loaded->objects, job.path);
+                    loaded->level = std::move(level);
+                } else {
+                    auto size = level->getSize();
+                    loaded->map = make_unique<Map>(size.x, size.y, 0, Config::LIGHTMAP_SUBDIVISION);
+                    loaded->map->loadLayers(*level);
+                    job.report(0.7f, "Lighting");
+                    LightBake::loadOrBake(*loaded->map, loaded->objects, job.path);
+                }
+            }
+            job.result = std::move(loaded);
+            job.report(1.0f, "Done");
+        } catch (...) {
+            job.error = current_exception();
+        }
+        job.finished = true;
+    }
+
+    static unique_ptr<Job> start(const string &path) {
+        auto job = make_unique<Job>();
+        job->path = path;
+        job->worker = thread(LevelLoader::run, std::ref(*job));
+        return job;
+    }
+
+    static void wait(unique_ptr<Job> &job) {
+        if (job && job->worker.joinable()) job->worker.join();
+    }
+public:
+    LevelLoader() = default;
+
+    LevelLoader(const LevelLoader &) = delete;
+    LevelLoader &operator=(const LevelLoader &) = delete;
+
+    ~LevelLoader() {
+        wait(current);
+        wait(preloaded);
+    }
+
+    // Starts loading the level to play next, picks up a preload of the same level
+    void load(const string &path) {
+        wait(current);
+        if (preloaded && preloaded->path == path) {
+            current = std::move(preloaded);
+        } else {
+            current = start(path);
+        }
+    }
+
+    // Loads a level in the background without making it the next one, replaces an earlier preload
+    void preload(const string &path) {
+        if (path.empty() || (preloaded && preloaded->path == path)) return;
+        wait(preloaded);
+        preloaded = start(path);
+    }
+
+    [[nodiscard]] bool isLoading() const {
+        return current != nullptr;
+    }
+
+    [[nodiscard]] bool isReady() const {
+        return current && current->finished;
+    }
+
+    [[nodiscard]] float getProgress() const {
+        return current ? current->progress.load() : 0.0f;
+    }
+
+    [[nodiscard]] string getStage() const {
+        if (!current) return "";
+        lock_guard<mutex> guard(current->stageLock);
+        return current->stage;
+    }
+
+    // The loaded level once isReady(), rethrows what went wrong while loading
+    unique_ptr<LoadedLevel> take() {
+        if (!current) throw runtime_error("No level is being loaded");
+        wait(current);
+        auto job = std::move(current);
+        if (job->error) rethrow_exception(job->error);
+        return std::move(job->result);
+    }
+};
+
+#endif //RENEGADE_ENGINE_LEVELLOADER_H
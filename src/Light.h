@@ -0,0 +1,113 @@
+#ifndef RENEGADE_ENGINE_LIGHT_H
+#define RENEGADE_ENGINE_LIGHT_H
+
+#include <raylib.h>
+#include <algorithm>
+#include <cstdint>
+
+// Packed RGB light amount per tile, 3 bytes. 128 per channel is the nominal "full" light,
+// same scale as the per tile intensity in Lightmap.
+struct LightColor {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+};
+
+namespace Light {
+    constexpr LightColor WHITE_LIGHT { 255, 255, 255 };
+
+    static inline LightColor fromColor(Color color) {
+        return { color.r, color.g, color.b };
+    }
+
+    static inline unsigned char clampChannel(int value) {
+        return (unsigned char)std::clamp(value, 0, 255);
+    }
+
+    // Tints an intensity (0..255 scale, 128 = full) with a light color
+    static inline LightColor tint(LightColor color, int intensity) {
+        return {
+            clampChannel(color.r * intensity / 255),
+            clampChannel(color.g * intensity / 255),
+            clampChannel(color.b * intensity / 255)
+        };
+    }
+
+    static inline LightColor add(LightColor a, LightColor b) {
+        return {
+            clampChannel(a.r + b.r),
+            clampChannel(a.g + b.g),
+            clampChannel(a.b + b.b)
+        };
+    }
+
+    static inline LightColor divide(LightColor color, int divisor) {
+        return {
+            (unsigned char)(color.r / divisor),
+            (unsigned char)(color.g / divisor),
+            (unsigned char)(color.b / divisor)
+        };
+    }
+
+    static inline int bilerp(int topLeft, int topRight, int bottomLeft, int bottomRight, int fx, int fy) {
+        int top = topLeft + (((topRight - topLeft) * fx) >> 8);
+        int bottom = bottomLeft + (((bottomRight - bottomLeft) * fx) >> 8);
+        return top + (((bottom - top) * fy) >> 8);
+    }
+
+    // Bilinear filter between two neighbouring sample rows, fx and fy are 8 bit fractions
+    static inline LightColor bilinear(const LightColor *top, const LightColor *bottom, int fx, int fy) {
+        return {
+            (unsigned char)bilerp(top[0].r, top[1].r, bottom[0].r, bottom[1].r, fx, fy),
+            (unsigned char)bilerp(top[0].g, top[1].g, bottom[0].g, bottom[1].g, fx, fy),
+            (unsigned char)bilerp(top[0].b, top[1].b, bottom[0].b, bottom[1].b, fx, fy)
+        };
+    }
+
+    // Same result as one channel of raylib's ColorBrightness
+    static inline unsigned char brighten(unsigned char base, float factor) {
+        factor = std::clamp(factor, -1.0f, 1.0f);
+        if (factor < 0) return (unsigned char)(base * (1.0f + factor));
+        return (unsigned char)((255 - base) * factor + base);
+    }
+
+    static inline Color shade(unsigned char base, LightColor light, float scale, float bias) {
+        return {
+            brighten(base, light.r / 128.0f * scale + bias),
+            brighten(base, light.g / 128.0f * scale + bias),
+            brighten(base, light.b / 128.0f * scale + bias),
+            255
+        };
+    }
+}
+
+// Maps a light channel and a base gray to its final pixel value for a fixed scale and bias, so the per
+// pixel cost of colored shading is three lookups. brighten is linear in the base for a given factor,
+// base * (1 - f) + 255 * f when brightening and base * (1 + f) when darkening, so each channel value
+// keeps the 8.8 fixed point factor and the offset of that line.
+class ShadeLut {
+private:
+    uint16_t baseScale[256] {};
+    unsigned char offset[256] {};
+
+    [[nodiscard]] inline unsigned char channel(unsigned char base, unsigned char light) const {
+        return (unsigned char)(((base * baseScale[light]) >> 8) + offset[light]);
+    }
+public:
+    ShadeLut() = default;
+
+    void build(float scale, float bias) {
+        for (int i = 0; i < 256; i++) {
+            float factor = std::clamp(i / 128.0f * scale + bias, -1.0f, 1.0f);
+            float baseFactor = factor < 0 ? 1.0f + factor : 1.0f - factor;
+            baseScale[i] = (uint16_t)(baseFactor * 256.0f);
+            offset[i] = factor < 0 ? 0 : (unsigned char)(255 * factor);
+        }
+    }
+
+    [[nodiscard]] inline Color shade(unsigned char base, LightColor light) const {
+        return { channel(base, light.r), channel(base, light.g), channel(base, light.b), 255 };
+    }
+};
+
+#endif //RENEGADE_ENGINE_LIGHT_H
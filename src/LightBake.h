@@ -0,0 +1,154 @@
+#ifndef RENEGADE_ENGINE_LIGHTBAKE_H
+#define RENEGADE_ENGINE_LIGHTBAKE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include "../config.hpp"
+#include "Map.h"
+#include "Level.h"
+#include "Hash.h"
+
+using namespace std;
+
+// Static lights ("light" objects) are baked once and cached next to the level file. The cache is
+// keyed by a hash of everything the bake depends on, so editing walls, ceiling or lights in Tiled
+// invalidates it. Dynamic lights (e.g. "light-flicker") are still handled at runtime.
+namespace LightBake {
+    constexpr char MAGIC[4] = { 'R', 'L', 'M', 'B' };
+    constexpr uint32_t VERSION = 2;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        int32_t width;
+        int32_t height;
+        int32_t subdivision;
+    };
+
+    static inline bool isStaticLight(const GameObject &obj) {
+        return obj.type == "light";
+    }
+
+    static inline string cachePath(const string &levelPath) {
+        return levelPath + ".lightcache";
+    }
+
+    // Grid is index based tile access with wall, ceiling and isSolid, like MapTiles
+    template<class Grid>
+    static uint64_t key(const Lightmap &lightmap, const Grid &tiles, const vector<GameObject> &objects) {
+        int count = lightmap.getWidth() * lightmap.getHeight();
+        Hash hash;
+        hash.add(VERSION);
+        hash.add(lightmap.getWidth());
+        hash.add(lightmap.getHeight());
+        hash.add(lightmap.getSubdivision());
+        hash.add(lightmap.getGlobalLight());
+        for (int i = 0; i < count; i++) {
+            hash.add(tiles.wall(i));
+        }
+        // the ceiling darkens the lightmap before lights are added
+        for (int i = 0; i < count; i++) {
+            hash.add(tiles.ceiling(i));
+        }
+        for (auto &obj : objects) {
+            if (!isStaticLight(obj)) continue;
+            hash.add(obj.position);
+            hash.add(obj.color);
+        }
+        return hash.get();
+    }
+
+    static bool load(const string &path, uint64_t key, Lightmap &lightmap) {
+        ifstream file(path, ios::binary | ios::ate);
+        if (!file) return false;
+        auto size = (size_t)file.tellg();
+        size_t intensityCount = lightmap.getWidth() * lightmap.getHeight();
+        size_t sampleCount = lightmap.getSampleWidth() * lightmap.getSampleHeight();
+        size_t expected = sizeof(Header) + intensityCount * sizeof(uint8_t) + sampleCount * sizeof(LightColor);
+        if (size != expected) return false;
+
+        vector<char> buffer(size);
+        file.seekg(0);
+        if (!file.read(buffer.data(), (streamsize)size)) return false;
+
+        Header header {};
+        memcpy(&header, buffer.data(), sizeof(Header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.key != key) return false;
+
+        vector<uint8_t> intensity(intensityCount);
+        vector<LightColor> samples(sampleCount);
+        const char *data = buffer.data() + sizeof(Header);
+        memcpy(intensity.data(), data, intensityCount * sizeof(uint8_t));
+        memcpy(samples.data(), data + intensityCount * sizeof(uint8_t), sampleCount * sizeof(LightColor));
+        lightmap.restore(std::move(intensity), std::move(samples));
+        return true;
+    }
+
+    static void save(const string &path, uint64_t key, Lightmap &lightmap) {
+        // the level being loaded and the preloaded one may bake the same level at the same time, each
+        // writes its own file
+        auto temporary = path + ".tmp" + to_string(hash<thread::id>()(this_thread::get_id()));
+        Header header {};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.key = key;
+        header.width = lightmap.getWidth();
+        header.height = lightmap.getHeight();
+        header.subdivision = lightmap.getSubdivision();
+        auto &intensity = lightmap.getIntensities();
+        auto &samples = lightmap.getSamples();
+        error_code error;
+        {
+            ofstream file(temporary, ios::binary | ios::trunc);
+            if (!file || !file.write((const char *)&header, sizeof(Header))
+                || !file.write((const char *)intensity.data(), (streamsize)(intensity.size() * sizeof(uint8_t)))
+                || !file.write((const char *)samples.data(), (streamsize)(samples.size() * sizeof(LightColor)))) {
+                cout << "WARNING: could not write light cache - " << path << endl;
+                filesystem::remove(temporary, error);
+                return;
+            }
+        }
+        // a crash while writing leaves the old cache or none, never a half written one
+        filesystem::rename(temporary, path, error);
+        if (error) {
+            cout << "WARNING: could not write light cache - " << path << endl;
+            filesystem::remove(temporary, error);
+        }
+    }
+
+    template<class Grid>
+    static void bake(Lightmap &lightmap, const Grid &tiles, const vector<GameObject> &objects) {
+        lightmap.applyCeiling(tiles);
+        for (auto &obj : objects) {
+            if (!isStaticLight(obj)) continue;
+            int x = (int)(obj.position.x / Config::TEXTURE_SIZE);
+            int y = (int)(obj.position.y / Config::TEXTURE_SIZE);
+            lightmap.bakeLight(y * lightmap.getWidth() + x, 128, Light::fromColor(obj.color), tiles);
+        }
+    }
+
+    static void bake(Map &map, const vector<GameObject> &objects) {
+        bake(map.getLightmap(), map.getTiles(), objects);
+    }
+
+    // Loads the baked static lighting of a level, or bakes and caches it if there is no valid cache
+    template<class Grid>
+    static void loadOrBake(Lightmap &lightmap, const Grid &tiles, const vector<GameObject> &objects, const string &levelPath) {
+        auto path = cachePath(levelPath);
+        auto cacheKey = key(lightmap, tiles, objects);
+        if (load(path, cacheKey, lightmap)) return;
+        bake(lightmap, tiles, objects);
+        save(path, cacheKey, lightmap);
+    }
+
+    static void loadOrBake(Map &map, const vector<GameObject> &objects, const string &levelPath) {
+        loadOrBake(map.getLightmap(), map.getTiles(), objects, levelPath);
+    }
+}
+
+#endif //RENEGADE_ENGINE_LIGHTBAKE_H
@@ -0,0 +1,436 @@
+#ifndef RENEGADE_ENGINE_LIGHTMAP_H
+#define RENEGADE_ENGINE_LIGHTMAP_H
+
+#include <vector>
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include "Math.h"
+#include "Light.h"
+#include "DirtyRect.h"
+
+using namespace std;
+
+constexpr double PI_MUL_2 = M_PI * 2;
+
+class Lightmap;
+
+// Non-owning read access to a Lightmap. Stays valid as long as the Lightmap lives, the storage is
+// never reallocated.
+struct LightmapView {
+    const Lightmap *source { nullptr };
+    const uint8_t *intensity { nullptr };
+    const LightColor *samples { nullptr };
+    int width { 0 };
+    int height { 0 };
+    int subdivision { 1 };
+    int sampleWidth { 0 };
+    int sampleHeight { 0 };
+
+    // Bilinear light lookup at a world position
+    [[nodiscard]] inline LightColor sample(float x, float y) const {
+        int u = (int)(x * (float)(subdivision * 256));
+        int v = (int)(y * (float)(subdivision * 256));
+        int sx = std::clamp(u >> 8, 0, sampleWidth - 2);
+        int sy = std::clamp(v >> 8, 0, sampleHeight - 2);
+        const LightColor *row = &samples[sy * sampleWidth + sx];
+        return Light::bilinear(row, row + sampleWidth, u & 0xFF, v & 0xFF);
+    }
+
+    [[nodiscard]] inline int intensityAt(int index) const {
+        return intensity[index];
+    }
+
+    [[nodiscard]] inline unsigned long long getGeneration() const;
+    [[nodiscard]] inline DirtyRect dirtySince(unsigned long long generation) const;
+};
+
+// Single store for all light of a map: the per tile intensity (128 = full, saturates at 255) and the colored
+// samples on the corners of a subdivision x subdivision grid per tile.
+// Every change bumps the generation and records the touched tiles, so derived representations
+// only need to refresh what changed since the generation they last saw.
+class Lightmap {
+private:
+    static constexpr int HISTORY_SIZE = 32;
+
+    struct DirtyEntry {
+        unsigned long long generation;
+        DirtyRect rect;
+    };
+
+    // A light that changes at runtime (e.g. "light-flicker"). Its area is rebuilt from the baked light
+    // on every change, so its contributions never pile up.
+    struct DynamicLight {
+        int index;
+        int value;
+        LightColor color;
+        DirtyRect reach;
+    };
+
+    // what is drawn: the baked light plus the dynamic lights
+    vector<uint8_t> intensity;
+    vector<LightColor> samples;
+    // the static, baked light
+    vector<uint8_t> bakedIntensity;
+    vector<LightColor> bakedSamples;
+    vector<DynamicLight> dynamicLights;
+    vector<unsigned int> sampleStamp;
+    unsigned int currentStamp { 0 };
+    int width;
+    int height;
+    int globalLight;
+    int subdivision;
+    int sampleWidth;
+    int sampleHeight;
+
+    unsigned long long generation { 0 };
+    array<DirtyEntry, HISTORY_SIZE> history {};
+
+    [[nodiscard]] int sampleToTileIndex(int sx, int sy) const {
+        int tx = std::min(sx / this->subdivision, this->width - 1);
+        int ty = std::min(sy / this->subdivision, this->height - 1);
+        return ty * this->width + tx;
+    }
+
+    [[nodiscard]] DirtyRect fullRect() const {
+        return { 0, 0, width, height };
+    }
+
+    void markDirty(DirtyRect rect) {
+        rect.x0 = std::max(rect.x0, 0);
+        rect.y0 = std::max(rect.y0, 0);
+        rect.x1 = std::min(rect.x1, width);
+        rect.y1 = std::min(rect.y1, height);
+        if (rect.isEmpty()) return;
+        this->generation++;
+        this->history[this->generation % HISTORY_SIZE] = { this->generation, rect };
+    }
+
+    static uint8_t toIntensity(int value) {
+        return (uint8_t)std::clamp(value, 0, 255);
+    }
+
+    // Writes the samples only, dirty marking is up to the caller
+    template<class Grid>
+    void propagateSamples(int x, int y, int value, LightColor color, const Grid &tiles, vector<LightColor> &target) {
+        if (value < 1) return;
+        const int sub = this->subdivision;
+        const float falloff = pow(0.8f, 1.0f / (float)sub);
+        const float reach = log((float)value) / -log(falloff);
+        const int rays = std::max(16, (int)ceil(PI_MUL_2 * reach));
+        const float cx = ((float)x + 0.5f) * (float)sub;
+        const float cy = ((float)y + 0.5f) * (float)sub;
+
+        // every light adds to a sample only once, even if several rays cross it
+        this->currentStamp++;
+        for (int r = 0; r < rays; r++) {
+            float rad = (float)(PI_MUL_2 * r / rays);
+            float dx = cos(rad);
+            float dy = sin(rad);
+            float light = (float)value;
+            for (int distance = 1; light >= 1.0f; distance++) {
+                int sx = (int)lround(cx + dx * (float)distance);
+                int sy = (int)lround(cy + dy * (float)distance);
+                if (sx < 0 || sy < 0 || sx >= sampleWidth || sy >= sampleHeight) break;
+                bool isWall = tiles.isSolid(sampleToTileIndex(sx, sy));
+                int si = sy * sampleWidth + sx;
+                if (this->sampleStamp[si] != this->currentStamp) {
+                    this->sampleStamp[si] = this->currentStamp;
+                    int sampleValue = isWall ? (int)light / 2 : (int)light;
+                    target[si] = Light::add(target[si], Light::tint(color, sampleValue));
+                }
+                if (isWall) break;
+                light *= falloff;
+            }
+        }
+    }
+
+    // Writes the per tile intensity only, dirty marking is up to the caller
+    template<class Grid>
+    void propagateIntensity(int x, int y, float value, const Grid &tiles, vector<uint8_t> &target) {
+        float light = value;
+        float step = PI_MUL_2 / 16;
+        float rad = 0;
+        float targetValue = this->globalLight > 0 ? 128 / this->globalLight : 0;
+        while(rad < PI_MUL_2) {
+            int currentLight = light * 128;
+            int distance = 1;
+            while (currentLight > this->globalLight) {
+                int lx = x + (int)(cos(rad) * distance);
+                int ly = y + (int)(sin(rad) * distance);
+                int index = ly * this->width + lx;
+                if (index < 0 || (size_t)index >= target.size()) break;
+                if (target[index] != this->globalLight && target[index] != currentLight) {
+                    target[index] = toIntensity(target[index] + currentLight);
+                    light = Math::lerp(light, targetValue, 0.2);
+                    distance++;
+                    continue;
+                }
+                if (tiles.isSolid(index)) {
+                    target[index] = toIntensity(currentLight / 2);
+                    break;
+                };
+                target[index] = toIntensity(currentLight);
+                light = Math::lerp(light, targetValue, 0.2);
+                distance++;
+            }
+            rad += step;
+        }
+    }
+
+    // Tiles a light at x, y can change. Without a global light neither propagation reaches further than
+    // the 0.8 per tile falloff, with one the intensity can spread over the whole map.
+    [[nodiscard]] DirtyRect lightReach(int x, int y, float value) const {
+        if (this->globalLight > 0) return fullRect();
+        int reach = value * 128 >= 1 ? (int)ceil(log(value * 128) / -log(0.8f)) + 1 : 1;
+        return { x - reach, y - reach, x + reach + 1, y + reach + 1 };
+    }
+
+    template<class Grid>
+    void applyLight(int index, int value, LightColor color, const Grid &tiles,
+                    vector<uint8_t> &targetIntensity, vector<LightColor> &targetSamples) {
+        int x = index % this->width;
+        int y = index / this->width;
+        targetIntensity[index] = toIntensity(value);
+        float tileValue = value / 128;
+        propagateIntensity(x, y, tileValue, tiles, targetIntensity);
+        propagateSamples(x, y, tileValue * 128, color, tiles, targetSamples);
+        LightColor tileColor = Light::tint(color, value);
+        for (int sy = y * subdivision; sy <= (y + 1) * subdivision; sy++) {
+            for (int sx = x * subdivision; sx <= (x + 1) * subdivision; sx++) {
+                targetSamples[sy * sampleWidth + sx] = tileColor;
+            }
+        }
+    }
+
+    [[nodiscard]] bool isSampleIn(int sx, int sy, const DirtyRect &rect) const {
+        int i = sampleToTileIndex(sx, sy);
+        int tx = i % this->width;
+        int ty = i / this->width;
+        return tx >= rect.x0 && tx < rect.x1 && ty >= rect.y0 && ty < rect.y1;
+    }
+
+    // Puts the baked light back into a rect and applies the dynamic lights again. Lights reaching into
+    // the rect are applied as a whole, so the rect grows by their reach and by the lights that reach into
+    // that, until it holds all of them.
+    template<class Grid>
+    void rebuild(DirtyRect rect, const Grid &tiles) {
+        rect.x0 = std::max(rect.x0, 0);
+        rect.y0 = std::max(rect.y0, 0);
+        rect.x1 = std::min(rect.x1, width);
+        rect.y1 = std::min(rect.y1, height);
+        if (rect.isEmpty()) return;
+        vector<bool> included(dynamicLights.size(), false);
+        for (bool grown = true; grown;) {
+            grown = false;
+            for (size_t i = 0; i < dynamicLights.size(); i++) {
+                if (included[i] || !dynamicLights[i].reach.intersects(rect)) continue;
+                included[i] = true;
+                rect.merge(dynamicLights[i].reach);
+                grown = true;
+            }
+        }
+        rect.x0 = std::max(rect.x0, 0);
+        rect.y0 = std::max(rect.y0, 0);
+        rect.x1 = std::min(rect.x1, width);
+        rect.y1 = std::min(rect.y1, height);
+        for (int y = rect.y0; y < rect.y1; y++) {
+            std::copy(bakedIntensity.begin() + y * width + rect.x0, bakedIntensity.begin() + y * width + rect.x1,
+                      intensity.begin() + y * width + rect.x0);
+        }
+        for (int sy = rect.y0 * subdivision; sy < std::min((rect.y1 + 1) * subdivision, sampleHeight); sy++) {
+            for (int sx = rect.x0 * subdivision; sx < std::min((rect.x1 + 1) * subdivision, sampleWidth); sx++) {
+                if (isSampleIn(sx, sy, rect)) samples[sy * sampleWidth + sx] = bakedSamples[sy * sampleWidth + sx];
+            }
+        }
+        for (size_t i = 0; i < dynamicLights.size(); i++) {
+            auto &light = dynamicLights[i];
+            if (included[i]) applyLight(light.index, light.value, light.color, tiles, intensity, samples);
+        }
+        markDirty(rect);
+    }
+
+    // Drops the dynamic lights, e.g. when the baked light is replaced
+    void resetLights() {
+        dynamicLights.clear();
+        intensity = bakedIntensity;
+        samples = bakedSamples;
+        markDirty(fullRect());
+    }
+
+public:
+    Lightmap(int width, int height, int globalLight = 0, int subdivision = 1) {
+        this->width = width;
+        this->height = height;
+        this->globalLight = globalLight;
+        this->subdivision = subdivision;
+        this->sampleWidth = width * subdivision + 1;
+        this->sampleHeight = height * subdivision + 1;
+
+        this->bakedIntensity = vector<uint8_t>(width * height, toIntensity(globalLight));
+        this->bakedSamples = vector<LightColor>(sampleWidth * sampleHeight, Light::tint(Light::WHITE_LIGHT, globalLight));
+        this->intensity = this->bakedIntensity;
+        this->samples = this->bakedSamples;
+        this->sampleStamp = vector<unsigned int>(sampleWidth * sampleHeight);
+    }
+
+    [[nodiscard]] LightmapView view() const {
+        return {
+            this,
+            this->intensity.data(),
+            this->samples.data(),
+            width,
+            height,
+            subdivision,
+            sampleWidth,
+            sampleHeight
+        };
+    }
+
+    [[nodiscard]] unsigned long long getGeneration() const {
+        return generation;
+    }
+
+    // Union of all tiles changed after the given generation. Falls back to the whole map if the
+    // consumer is further behind than the recorded history.
+    [[nodiscard]] DirtyRect dirtySince(unsigned long long since) const {
+        DirtyRect result;
+        if (since >= this->generation) return result;
+        if (this->generation - since > HISTORY_SIZE) return fullRect();
+        for (auto g = since + 1; g <= this->generation; g++) {
+            result.merge(this->history[g % HISTORY_SIZE].rect);
+        }
+        return result;
+    }
+
+    // Darkens the tiles below a ceiling
+    template<class Grid>
+    void applyCeiling(const Grid &tiles) {
+        for (size_t i = 0; i < bakedIntensity.size(); i++) {
+            if (tiles.ceiling(i) > 0 && !tiles.isSolid(i)) {
+                bakedIntensity[i] = bakedIntensity[i] / 3;
+            }
+        }
+        for (int sy = 0; sy < sampleHeight; sy++) {
+            for (int sx = 0; sx < sampleWidth; sx++) {
+                int i = sampleToTileIndex(sx, sy);
+                if (tiles.ceiling(i) > 0 && !tiles.isSolid(i)) {
+                    int si = sy * sampleWidth + sx;
+                    bakedSamples[si] = Light::divide(bakedSamples[si], 3);
+                }
+            }
+        }
+        rebuild(fullRect(), tiles);
+    }
+
+    void setIntensities(const vector<int> &data) {
+        if (data.size() != this->bakedIntensity.size()) {
+            throw runtime_error("Invalid lightmap data");
+        }
+        for (size_t i = 0; i < data.size(); i++) {
+            this->bakedIntensity[i] = toIntensity(data[i]);
+        }
+        for (int sy = 0; sy < sampleHeight; sy++) {
+            for (int sx = 0; sx < sampleWidth; sx++) {
+                bakedSamples[sy * sampleWidth + sx] = Light::tint(Light::WHITE_LIGHT, data[sampleToTileIndex(sx, sy)]);
+            }
+        }
+        resetLights();
+    }
+
+    // Replaces the whole baked light, e.g. with a cached one
+    void restore(vector<uint8_t> &&intensityData, vector<LightColor> &&sampleData) {
+        if (intensityData.size() != this->bakedIntensity.size() || sampleData.size() != this->bakedSamples.size()) {
+            throw runtime_error("Invalid lightmap data");
+        }
+        this->bakedIntensity = std::move(intensityData);
+        this->bakedSamples = std::move(sampleData);
+        resetLights();
+    }
+
+    // The baked light, without the dynamic lights
+    [[nodiscard]] const vector<uint8_t> &getIntensities() const {
+        return this->bakedIntensity;
+    }
+
+    [[nodiscard]] const vector<LightColor> &getSamples() const {
+        return this->bakedSamples;
+    }
+
+    [[nodiscard]] int getIntensity(int index) const {
+        return this->intensity[index];
+    }
+
+    [[nodiscard]] LightColor getSample(int sampleIndex) const {
+        return this->samples[sampleIndex];
+    }
+
+    // Adds a static light to the baked light
+    template<class Grid>
+    void bakeLight(int index, int value, LightColor color, const Grid &tiles) {
+        if (index < 0 || (size_t)index >= this->bakedIntensity.size()) {
+            cout << "WARNING: light index invalid - " << to_string(index) << endl;
+            return;
+        }
+        applyLight(index, value, color, tiles, bakedIntensity, bakedSamples);
+        rebuild(lightReach(index % width, index / width, value / 128), tiles);
+    }
+
+    // Sets the dynamic light on a tile, replacing the one set there before
+    template<class Grid>
+    void setLight(int index, int value, LightColor color, const Grid &tiles) {
+        if (index < 0 || (size_t)index >= this->intensity.size()) {
+            cout << "WARNING: light index invalid - " << to_string(index) << endl;
+            return;
+        }
+        DirtyRect reach = lightReach(index % width, index / width, value / 128);
+        auto light = std::find_if(dynamicLights.begin(), dynamicLights.end(), [index](const DynamicLight &l) {
+            return l.index == index;
+        });
+        if (light == dynamicLights.end()) {
+            dynamicLights.push_back({ index, value, color, reach });
+            rebuild(reach, tiles);
+            return;
+        }
+        DirtyRect changed = light->reach;
+        changed.merge(reach);
+        *light = { index, value, color, reach };
+        rebuild(changed, tiles);
+    }
+
+    [[nodiscard]] int getGlobalLight() const {
+        return globalLight;
+    }
+
+    [[nodiscard]] int getSubdivision() const {
+        return subdivision;
+    }
+
+    [[nodiscard]] int getSampleWidth() const {
+        return sampleWidth;
+    }
+
+    [[nodiscard]] int getSampleHeight() const {
+        return sampleHeight;
+    }
+
+    [[nodiscard]] int getWidth() const {
+        return width;
+    }
+
+    [[nodiscard]] int getHeight() const {
+        return height;
+    }
+};
+
+unsigned long long LightmapView::getGeneration() const {
+    return source->getGeneration();
+}
+
+DirtyRect LightmapView::dirtySince(unsigned long long generation) const {
+    return source->dirtySince(generation);
+}
+
+#endif //RENEGADE_ENGINE_LIGHTMAP_H
@@ -6,150 +6,338 @@
 #define RENEGADE_ENGINE_MAP_H
 
 #include <vector>
+#include <iostream>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include "../config.hpp"
 #include "Math.h"
+#include "TileGrid.h"
+#include "ChunkedTiles.h"
+#include "SolidGrid.h"
+#include "DistanceField.h"
+#include "Lightmap.h"
+#include "CookedLevel.h"
 
 using namespace  std;
 
-constexpr double PI_MUL_2 = M_PI * 2;
+using MapTiles = TileGrid<Config::INTERLEAVED_TILES ? TileLayout::Interleaved : TileLayout::StructOfArrays, Config::TileIdType>;
+using MapLayerView = TileLayerView<Config::TileIdType>;
+
+// Index based tile access over the resident chunks of a streamed map, as used by the lightmap.
+// Tiles that are not resident are empty. Hold ChunkedTiles::pin while using it off the render thread.
+class ChunkGrid {
+private:
+    const ChunkedTiles &chunks;
+    int width;
+public:
+    ChunkGrid(const ChunkedTiles &chunks, int width) : chunks(chunks), width(width) {}
+
+    [[nodiscard]] inline bool isSolid(int index) const {
+        auto cell = chunks.cellAt(index % width, index / width);
+        return cell != nullptr && (cell->flags & TileFlags::SOLID);
+    }
+
+    [[nodiscard]] inline Config::TileIdType ceiling(int index) const {
+        auto cell = chunks.cellAt(index % width, index / width);
+        return cell != nullptr ? cell->ceiling : 0;
+    }
+};
+
+// Index based tile access read straight from a chunk source, for a streamed map's tiles before any are
+// resident (baking its light). Keeps the chunks of about two rows of chunks.
+class ChunkSourceGrid {
+private:
+    ChunkSource &source;
+    int width;
+    size_t maxChunks;
+    // nullptr for chunks without tiles
+    mutable unordered_map<uint64_t, unique_ptr<Chunk>> chunks;
+    const ChunkCell empty {};
+
+    [[nodiscard]] const ChunkCell &cellAt(int index) const {
+        int x = index % width;
+        int y = index / width;
+        int cx = x >> Chunk::SHIFT;
+        int cy = y >> Chunk::SHIFT;
+        auto found = chunks.find(chunkKey(cx, cy));
+        if (found == chunks.end()) {
+            if (chunks.size() >= maxChunks) chunks.clear();
+            auto chunk = make_unique<Chunk>();
+            chunk->x = cx;
+            chunk->y = cy;
+            if (!source.load(cx, cy, *chunk)) chunk = nullptr;
+            found = chunks.emplace(chunkKey(cx, cy), std::move(chunk)).first;
+        }
+        if (found->second == nullptr) return empty;
+        return found->second->cells[((y & Chunk::MASK) << Chunk::SHIFT) | (x & Chunk::MASK)];
+    }
+public:
+    ChunkSourceGrid(ChunkSource &source, int width)
+        : source(source), width(width), maxChunks((size_t)(width / Chunk::SIZE + 2) * 2) {}
+
+    [[nodiscard]] Config::TileIdType wall(int index) const {
+        return cellAt(index).wall;
+    }
+
+    [[nodiscard]] Config::TileIdType ceiling(int index) const {
+        return cellAt(index).ceiling;
+    }
+
+    [[nodiscard]] bool isSolid(int index) const {
+        return cellAt(index).flags & TileFlags::SOLID;
+    }
+};
 
 class Map {
 private:
-    vector<int> floorData;
-    vector<int> ceilingData;
-    vector<int> wallsData;
-    vector<int> lightMap;
+    // the mapped level file that tiles and solid live in, if the map was loaded from one
+    shared_ptr<CookedLevel> cooked;
+    MapTiles tiles;
+    // set for streamed maps, which keep their tiles in chunks instead of tiles
+    unique_ptr<ChunkedTiles> chunks;
+    // walls as one bit per tile, what the raycaster, collision and path finding test against
+    SolidGrid solid;
+    DistanceField distances;
+    Lightmap lightmap;
     int width;
     int height;
-    int globalLight;
+    // held by the update thread while it uses solid and distances, and while they are written
+    mutable mutex gridMutex;
+    // solid rows of chunks installed on the render thread, written to the grids by publishWalls
+    struct ChunkWalls {
+        int x;
+        int y;
+        uint64_t rows[Chunk::SIZE];
+    };
+    vector<ChunkWalls> pendingWalls;
+
+    // Call with the grid lock held
+    void publishWalls() {
+        for (auto &walls : pendingWalls) {
+            int x0 = walls.x * Chunk::SIZE;
+            int y0 = walls.y * Chunk::SIZE;
+            this->solid.setBlock(x0, y0, walls.rows, Chunk::SIZE, Chunk::SIZE);
+            this->distances.update(x0, y0, x0 + Chunk::SIZE, y0 + Chunk::SIZE);
+        }
+        pendingWalls.clear();
+    }
+
+    // Takes over the layer data, the source is released once converted to tile ids
+    template<typename Setter>
+    void setLayer(vector<int> &&data, const string &name, Setter set) {
+        if (data.size() != this->tiles.size()) {
+            throw runtime_error("Invalid " + name + " data");
+        }
+        for (size_t i = 0; i < data.size(); i++) {
+            set((int)i, data[i]);
+        }
+        vector<int>().swap(data);
+    }
 public:
-    Map(int width, int height, unsigned char globalLight = 0) {
+    Map(int width, int height, unsigned char globalLight = 0, int lightSubdivision = 1)
+        : tiles(width, height), solid(width, height), distances(solid), lightmap(width, height, globalLight, lightSubdivision) {
         this->width = width;
         this->height = height;
-        this->globalLight = globalLight;
+    }
 
-        size_t map_size = width * height;
+    // Map loaded from a cooked level, tiles and solid grid are used in place in the mapped file
+    explicit Map(shared_ptr<CookedLevel> level)
+        : cooked(std::move(level)),
+          tiles(cooked->getWidth(), cooked->getHeight(), cooked->getCells()),
+          solid(cooked->getWidth(), cooked->getHeight(), cooked->getSolidWords()),
+          distances(solid),
+          lightmap(cooked->getWidth(), cooked->getHeight(), cooked->getGlobalLight(), cooked->getLightSubdivision()) {
+        this->width = cooked->getWidth();
+        this->height = cooked->getHeight();
+        this->lightmap.restore(cooked->getLightIntensities(), cooked->getLightSamples());
+    }
 
-        this->wallsData = vector<int>(map_size);
-        this->floorData = vector<int>(map_size);
-        this->ceilingData = vector<int>(map_size);
-        this->lightMap = vector<int>(map_size);
+    // Streamed map, tiles are paged in around the player by the chunks (see updateStreaming)
+    Map(int width, int height, unique_ptr<ChunkedTiles> chunks, unsigned char globalLight = 0, int lightSubdivision = 1)
+        : tiles(0, 0), chunks(std::move(chunks)), solid(width, height, true), distances(solid), lightmap(width, height, globalLight, lightSubdivision) {
+        this->width = width;
+        this->height = height;
+        // tiles that were never resident stay solid, evicted chunks keep their last known walls
+        this->chunks->setOnInstall([this](const Chunk &chunk) {
+            ChunkWalls walls { chunk.x, chunk.y, {} };
+            for (int y = 0; y < Chunk::SIZE; y++) {
+                for (int x = 0; x < Chunk::SIZE; x++) {
+                    if (chunk.cells[(y << Chunk::SHIFT) | x].flags & TileFlags::SOLID) walls.rows[y] |= 1ull << x;
+                }
+            }
+            this->pendingWalls.push_back(walls);
+        });
+    }
 
-        this->wallsData.reserve(width * height);
-        std::fill(this->wallsData.begin(), this->wallsData.end(), 0);
+    [[nodiscard]] bool isStreaming() const {
+        return this->chunks != nullptr;
+    }
 
-        this->floorData.reserve(width * height);
-        std::fill(this->floorData.begin(), this->floorData.end(), 0);
+    [[nodiscard]] const MapTiles &getTiles() const {
+        return this->tiles;
+    }
 
-        this->ceilingData.reserve(width * height);
-        std::fill(this->ceilingData.begin(), this->ceilingData.end(), 0);
+    [[nodiscard]] const SolidGrid &getSolidGrid() const {
+        return this->solid;
+    }
 
-        this->lightMap.reserve(width * height);
-        std::fill(this->lightMap.begin(), this->lightMap.end(), globalLight);
+    [[nodiscard]] const DistanceField &getDistances() const {
+        return this->distances;
     }
 
-    shared_ptr<vector<int>> getWalls() {
-        return make_shared<vector<int>>(this->wallsData);
+    [[nodiscard]] const ChunkedTiles &getChunks() const {
+        return *this->chunks;
     }
 
-    shared_ptr<vector<int>> getLightmap() {
-        return make_shared<vector<int>>(this->lightMap);
+    // Pages chunks in and out around a tile, call once per frame for streamed maps. The walls of new
+    // chunks reach the solid grid between two updates, a frame later if the update thread is busy.
+    void updateStreaming(int tileX, int tileY) {
+        if (!this->chunks) return;
+        this->chunks->update(tileX, tileY);
+        if (pendingWalls.empty()) return;
+        unique_lock<mutex> lock(gridMutex, try_to_lock);
+        if (lock.owns_lock()) publishWalls();
     }
 
-    shared_ptr<vector<int>> getFloor() {
-        return make_shared<vector<int>>(this->floorData);
+    // Blocks until the chunks around a tile are resident
+    void prefetch(int tileX, int tileY) {
+        if (!this->chunks) return;
+        this->chunks->prefetch(tileX, tileY);
+        lock_guard<mutex> lock(gridMutex);
+        publishWalls();
     }
 
-    shared_ptr<vector<int>> getCeiling() {
-        return make_shared<vector<int>>(this->ceilingData);
+    // Keeps solid and distances from changing while held. Threads other than the render thread hold it
+    // while they use them.
+    [[nodiscard]] unique_lock<mutex> lockGrid() const {
+        return unique_lock<mutex>(gridMutex);
     }
 
-    void setWalls(vector<int> &data) {
-        if (data.size() != this->wallsData.size()) {
-            throw runtime_error("Invalid walls data");
-        }
-        for (int i = 0; i < data.size(); i++) {
-            this->wallsData[i] = data[i];
-        }
+    // Tiles outside the map and tiles of streamed chunks that were never resident are solid
+    [[nodiscard]] bool isSolidAt(int x, int y) const {
+        return this->solid.isSolid(x, y);
     }
 
-    void setFloor(vector<int> &data) {
-        if (data.size() != this->floorData.size()) {
-            throw runtime_error("Invalid walls data");
-        }
-        for (int i = 0; i < data.size(); i++) {
-            this->floorData[i] = data[i];
-        }
+    [[nodiscard]] MapLayerView getWalls() const {
+        return this->tiles.layer(TileLayer::Wall);
     }
 
-    void setCeiling(vector<int> &data) {
-        if (data.size() != this->ceilingData.size()) {
-            throw runtime_error("Invalid walls data");
-        }
-        for (int i = 0; i < data.size(); i++) {
-            this->ceilingData[i] = data[i];
-        }
+    Lightmap &getLightmap() {
+        return this->lightmap;
+    }
+
+    [[nodiscard]] MapLayerView getFloor() const {
+        return this->tiles.layer(TileLayer::Floor);
+    }
+
+    [[nodiscard]] MapLayerView getCeiling() const {
+        return this->tiles.layer(TileLayer::Ceiling);
+    }
+
+    void setWalls(vector<int> &&data) {
+        setLayer(std::move(data), "walls", [this](int i, int value) {
+            this->tiles.setWall(i, value);
+            this->solid.set(i % width, i / width, this->tiles.isSolid(i));
+        });
+        this->distances.update(0, 0, width, height);
+    }
+
+    void setFloor(vector<int> &&data) {
+        setLayer(std::move(data), "floor", [this](int i, int value) { this->tiles.setFloor(i, value); });
+    }
+
+    void setCeiling(vector<int> &&data) {
+        setLayer(std::move(data), "ceiling", [this](int i, int value) { this->tiles.setCeiling(i, value); });
+    }
+
+    // Reads walls, floor and ceiling straight from a level into the tiles, without a copy of the layers.
+    // Each layer is decoded on its own thread.
+    template<class LayerSource>
+    void loadLayers(LayerSource &level) {
+        auto floor = async(launch::async, [&] {
+            level.readLayerData("floor", [this](int i, int value) { this->tiles.fill(TileLayer::Floor, i, value); });
+        });
+        auto ceiling = async(launch::async, [&] {
+            level.readLayerData("ceiling", [this](int i, int value) { this->tiles.fill(TileLayer::Ceiling, i, value); });
+        });
+        level.readLayerData("walls", [this](int i, int value) {
+            this->tiles.fill(TileLayer::Wall, i, value);
+            this->solid.set(i % width, i / width, this->tiles.isSolid(i));
+        });
+        floor.get();
+        ceiling.get();
+        this->tiles.touch();
+        this->distances.update(0, 0, width, height);
+    }
+
+    // Runtime change of a single wall (doors, destructible walls), visible to all views at once.
+    // Call from the render thread with lockGrid held.
+    void setWall(int index, int value) {
+        this->tiles.setWall(index, value);
+        int x = index % width;
+        int y = index / width;
+        this->solid.set(x, y, this->tiles.isSolid(index));
+        this->distances.update(x, y, x + 1, y + 1);
     }
 
     void autoLightMap() {
-        for (int i = 0; i < lightMap.size(); i++) {
-            if (ceilingData[i] > 0 && wallsData[i] <= 0) {
-                lightMap[i] = lightMap[i] / 3;
-            }
+        if (this->chunks) {
+            auto pin = this->chunks->pin();
+            this->lightmap.applyCeiling(ChunkGrid(*this->chunks, width));
+        } else {
+            this->lightmap.applyCeiling(this->tiles);
         }
     }
 
     void setLightmap(vector<int> &data) {
-        if (data.size() != this->lightMap.size()) {
-            throw runtime_error("Invalid walls data");
-        }
-        for (int i = 0; i < data.size(); i++) {
-            this->lightMap[i] = data[i];
-        }
+        this->lightmap.setIntensities(data);
     }
 
     int getLightAt(int index) {
-        return this->lightMap[index];
+        return this->lightmap.getIntensity(index);
     }
 
-    void setLight(int index, int value) {
-        if (index < 0 || index > this->lightMap.size()) {
-            cout << "WARNING: light index invalid - " << to_string(index) << endl;
-            return;
+    void setLight(int index, int value, LightColor color = Light::WHITE_LIGHT) {
+        if (this->chunks) {
+            // called from the update thread while the render thread pages chunks
+            auto pin = this->chunks->pin();
+            this->lightmap.setLight(index, value, color, ChunkGrid(*this->chunks, width));
+        } else {
+            this->lightmap.setLight(index, value, color, this->tiles);
         }
-        this->lightMap[index] = value;
-        calculateLight(index % this->width, index / this->width, value / 128);
-    }
-
-    void calculateLight(int x, int y, float value) {
-        int i = y * this->width + x;
-        float light = value;
-        float step = PI_MUL_2 / 16;
-        float rad = 0;
-        float targetValue = 128 / this->globalLight;
-        while(rad < PI_MUL_2) {
-            int currentLight = light * 128;
-            int distance = 1;
-            while (currentLight > this->globalLight) {
-                int lx = x + (int)(cos(rad) * distance);
-                int ly = y + (int)(sin(rad) * distance);
-                int index = ly * this->width + lx;
-                if (index < 0 || index > this->lightMap.size()) break;
-                if (this->lightMap[index] != this->globalLight && this->lightMap[index] != currentLight) {
-                    this->lightMap[index] += currentLight;
-                    light = Math::lerp(light, targetValue, 0.2);
-                    distance++;
-                    continue;
-                }
-                if (this->wallsData[index] > 0) {
-                    this->lightMap[index] = currentLight / 2;
-                    break;
-                };
-                this->lightMap[index] = currentLight;
-                light = Math::lerp(light, targetValue, 0.2);
-                distance++;
-            }
-            rad += step;
+    }
+
+    [[nodiscard]] size_t memoryFootprint() const {
+        return this->tiles.memoryFootprint()
+            + this->solid.memoryFootprint()
+            + this->distances.memoryFootprint()
+            // baked and drawn light are kept side by side
+            + 2 * this->lightmap.getIntensities().capacity() * sizeof(uint8_t)
+            + 2 * this->lightmap.getSamples().capacity() * sizeof(LightColor);
+    }
+
+    void printMemoryReport() const {
+        size_t tileBytes = this->tiles.memoryFootprint();
+        size_t intensityBytes = 2 * this->lightmap.getIntensities().capacity() * sizeof(uint8_t);
+        size_t sampleBytes = 2 * this->lightmap.getSamples().capacity() * sizeof(LightColor);
+        cout << "Map " << width << "x" << height << " memory:" << endl;
+        if (this->cooked) {
+            cout << "  tiles (" << MapTiles::layoutName() << ", mapped from a cooked level of "
+                 << this->cooked->getSize() << " bytes)" << endl;
+        } else if (this->chunks) {
+            cout << "  tiles (streamed): " << this->chunks->residentChunks() << " resident chunks of "
+                 << sizeof(Chunk) << " bytes" << endl;
+        } else {
+            cout << "  tiles (" << MapTiles::layoutName() << "): " << tileBytes << " bytes, "
+                 << (double)tileBytes / this->tiles.size() << " per tile" << endl;
         }
+        cout << "  solid grid: " << this->solid.memoryFootprint() << " bytes" << endl;
+        cout << "  wall distances: " << this->distances.memoryFootprint() << " bytes" << endl;
+        cout << "  light intensity (baked and drawn): " << intensityBytes << " bytes" << endl;
+        cout << "  light samples (" << this->lightmap.getSubdivision() << "x" << this->lightmap.getSubdivision()
+             << " per tile): " << sampleBytes << " bytes" << endl;
+        cout << "  total: " << memoryFootprint() << " bytes" << endl;
     }
 
     [[nodiscard]] int getWidth() const {
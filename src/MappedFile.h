@@ -0,0 +1,73 @@
+#ifndef RENEGADE_ENGINE_MAPPEDFILE_H
+#define RENEGADE_ENGINE_MAPPEDFILE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// A whole file mapped into memory. Pages are read on first access, writes are private to the process
+// and never reach the file. Falls back to reading the file on platforms without mmap.
+class MappedFile {
+private:
+    unsigned char *bytes { nullptr };
+    size_t length { 0 };
+#ifdef _WIN32
+    vector<unsigned char> buffer;
+#endif
+public:
+    explicit MappedFile(const string &path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info {};
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                this->bytes = (unsigned char *)mapping;
+                this->length = (size_t)info.st_size;
+            }
+        }
+        ::close(fd);
+#else
+        ifstream file(path, ios::binary | ios::ate);
+        if (!file) return;
+        this->buffer = vector<unsigned char>((size_t)file.tellg());
+        file.seekg(0);
+        if (!file.read((char *)buffer.data(), (streamsize)buffer.size())) return;
+        this->bytes = buffer.data();
+        this->length = buffer.size();
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (bytes != nullptr) munmap(bytes, length);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    [[nodiscard]] bool isOpen() const {
+        return bytes != nullptr;
+    }
+
+    [[nodiscard]] unsigned char *data() const {
+        return bytes;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return length;
+    }
+};
+
+#endif //RENEGADE_ENGINE_MAPPEDFILE_H
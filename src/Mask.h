@@ -6,42 +6,112 @@
 #define RENEGADE_ENGINE_MASK_H
 
 #include "Entities.h"
+#include "FlowField.h"
+#include "PathService.h"
+#include "SolidGrid.h"
+#include "../config.hpp"
 #include "../lib/AStar/AStar.hpp"
+#include "../lib/AStar/Replanner.hpp"
 
 class Mask : public Entity {
 private:
     unique_ptr<Player>& player;
-    unique_ptr<AStar::Generator>& pathGenerator;
+    const SolidGrid &grid;
+    PathService &paths;
+    const FlowField &flowField;
     vector<AStar::Vec2i> path;
+    // the path asked for, the current one is walked until it is there
+    shared_future<AStar::CoordinateList> requestedPath;
+    // repairs the path whenever the player moves, the path service only searches when it can't
+    AStar::Replanner replanner { Config::REPLAN_STATES };
+    unsigned long long gridVersion { ~0ull };
+    vector<DirtyRect> gridChanges;
     Vector2 currentTarget { 0, 0 };
     AStar::Vec2i lastPlayerPosition { 0, 0 };
     int pathIndex { 0 };
     double checkPositionTimer = 5.0;
     float speed = 1.0f;
     bool sleep = false;
+    // walking the shared flow field instead of the own path
+    bool followingFlow = false;
 public:
-    explicit Mask(unique_ptr<Player> &player, unique_ptr<AStar::Generator>& generator)
-        : player(player), pathGenerator(generator) {}
+    explicit Mask(unique_ptr<Player> &player, const SolidGrid &grid, PathService &paths, const FlowField &flowField)
+        : player(player), grid(grid), paths(paths), flowField(flowField) {}
 
     void reset() {
         int x = GetRandomValue(0, 40);
         int y = GetRandomValue(0, 40);
         this->position.x = (float)x;
         this->position.y = (float)y;
+        // waits here for the path
+        this->currentTarget = this->position;
+        this->path.clear();
         this->calculatePath();
     }
 
     void calculatePath() {
         lastPlayerPosition = { (int)player->position.x, (int)player->position.y };
-        AStar::Vec2i source = { (int)this->position.x, (int)this->position.y };
-        path = pathGenerator->findPath(
-                { (int)this->position.x, (int)this->position.y },
-                lastPlayerPosition
-        );
-        if (path.size() <= 1) {
+        if (replan()) return;
+        // beyond the flow field's reach through the hierarchy of the map
+        PathOptions options;
+        options.hierarchyRange = Config::CHASE_RANGE;
+        requestedPath = paths.request({ (int)this->position.x, (int)this->position.y }, lastPlayerPosition, 0, options);
+    }
+
+    // Updates the path right away with the replanner, false when it can't find one within its budget.
+    // Runs on the update thread, so the budget stays small and longer searches go to the path service.
+    bool replan() {
+        auto version = grid.getVersion();
+        if (version != gridVersion) {
+            // the search is repaired around changed tiles, it starts over when there are too many of them
+            // or the grid no longer knows which ones changed
+            gridChanges.clear();
+            long long area = 0;
+            bool known = gridVersion != ~0ull && grid.changesSince(gridVersion, gridChanges);
+            for (auto &rect : gridChanges) {
+                area += rect.area();
+            }
+            if (!known || area > (long long)Config::REPLAN_STATES) {
+                replanner.setWorldSize({ grid.getWidth(), grid.getHeight() });
+                replanner.setCollisionGrid({ grid.data(), grid.getRowWords() });
+            } else {
+                for (auto &rect : gridChanges) {
+                    for (int y = rect.y0; y < rect.y1; y++) {
+                        for (int x = rect.x0; x < rect.x1; x++) {
+                            replanner.invalidate({ x, y });
+                        }
+                    }
+                }
+            }
+            gridVersion = version;
+        }
+        auto found = replanner.findPath({ (int)this->position.x, (int)this->position.y }, lastPlayerPosition);
+        if (!(found.front() == lastPlayerPosition)) return false;
+        // an older request would take the path back
+        requestedPath = {};
+        if (found.size() <= 1) {
+            // standing on the player's tile, caught like in takePath
+            this->reset();
+            return true;
+        }
+        path = std::move(found);
+        reverse(path.begin(), path.end());
+        pathIndex = 0;
+        nextTarget(pathIndex);
+        return true;
+    }
+
+    // Switches to the requested path once it was found
+    void takePath() {
+        if (!requestedPath.valid() || requestedPath.wait_for(chrono::seconds(0)) != future_status::ready) return;
+        auto found = requestedPath.get();
+        requestedPath = {};
+        if (followingFlow) return;
+        if (found.size() <= 1) {
             this->reset();
             return;
         }
+        path = std::move(found);
         reverse(path.begin(), path.end());
         pathIndex = 0;
         currentTarget = Vector2 {
@@ -57,6 +127,14 @@ public:
         };
     }
 
+    // Next tile toward the player from the flow field, false where the field does not lead anywhere
+    bool nextFlowTarget() {
+        int x, y;
+        if (!flowField.next((int)this->position.x, (int)this->position.y, x, y)) return false;
+        currentTarget = Vector2 { (float)x + 0.5f, (float)y + 0.5f };
+        return true;
+    }
+
     float lerp(float a, float b, float f) {
         return a * (1.0 - f) + (b * f);
     }
@@ -64,10 +142,11 @@ public:
     void update(double dt) override {
         checkPositionTimer -= dt;
         if (checkPositionTimer <= 0) {
-            this->path.clear();
+            if (!followingFlow) calculatePath();
             checkPositionTimer = 10.0;
         }
-        if (this->path.empty()) calculatePath();
+        takePath();
+        if (!followingFlow && this->path.empty() && !requestedPath.valid()) calculatePath();
         this->position = {
                 lerp(this->position.x, (float)currentTarget.x, (float)dt * speed),
                 lerp(this->position.y, (float)currentTarget.y, (float)dt * speed),
@@ -78,8 +157,27 @@ public:
         tx = currentTarget.x;
         ty = currentTarget.y;
         if (std::abs(px-tx)<0.1 && std::abs(py-ty)<0.1) {
+            // the shared field wherever it reaches, the own path only beyond it
+            if (nextFlowTarget()) {
+                followingFlow = true;
+                this->path.clear();
+                return;
+            }
+            if (followingFlow) {
+                followingFlow = false;
+                calculatePath();
+                return;
+            }
+            AStar::Vec2i playerPosition { (int)player->position.x, (int)player->position.y };
+            if (!(playerPosition == lastPlayerPosition)) {
+                calculatePath();
+                return;
+            }
             this->pathIndex++;
-            if (pathIndex > path.size()) return;
+            if ((size_t)pathIndex >= path.size()) {
+                this->path.clear();
+                return;
+            }
             nextTarget(pathIndex);
         }
     }
@@ -0,0 +1,257 @@
+#ifndef RENEGADE_ENGINE_PATHSERVICE_H
+#define RENEGADE_ENGINE_PATHSERVICE_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include "SolidGrid.h"
+#include "../lib/AStar/AStar.hpp"
+#include "../lib/AStar/Hierarchy.hpp"
+
+using namespace std;
+
+// How a PathService request searches
+struct PathOptions {
+    bool diagonalMovement { true };
+    // see AStar::Generator::setJumpPointSearch, only used with diagonal movement
+    bool jumpPointSearch { true };
+    // requests with diagonal movement whose source and target are further apart than this many tiles on
+    // either axis search an AStar::Hierarchy instead, its paths can be a few percent longer. 0 never does.
+    int hierarchyRange { 0 };
+};
+
+// Finds paths on worker threads, so that nothing waits for a search on the update thread. A request
+// returns a future of the path in AStar::Generator::findPath's form (target first). Requests that are
+// still waiting are answered together when they ask for the same path, and higher priorities are
+// searched first. Long requests can go through a hierarchy of the map, see PathOptions. Every search
+// runs on a copy of the solid grid taken when it was requested, the copy is shared by all requests until
+// the grid changes.
+class PathService {
+private:
+    struct Snapshot {
+        int width;
+        int height;
+        int rowWords;
+        unsigned long long version;
+        vector<uint64_t> words;
+    };
+
+    struct Key {
+        AStar::Vec2i source;
+        AStar::Vec2i target;
+        int options;
+
+        bool operator==(const Key &other) const {
+            return source.x == other.source.x && source.y == other.source.y
+                && target.x == other.target.x && target.y == other.target.y && options == other.options;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            uint64_t hash = (uint64_t)(uint32_t)key.source.x * 0x9E3779B97F4A7C15ull;
+            hash = (hash ^ (uint32_t)key.source.y) * 0x9E3779B97F4A7C15ull;
+            hash = (hash ^ (uint32_t)key.target.x) * 0x9E3779B97F4A7C15ull;
+            hash = (hash ^ (uint32_t)key.target.y) * 0x9E3779B97F4A7C15ull;
+            return (size_t)(hash ^ (uint64_t)key.options);
+        }
+    };
+
+    struct Job {
+        Key key;
+        PathOptions options;
+        shared_ptr<const Snapshot> snapshot;
+        promise<AStar::CoordinateList> result;
+        shared_future<AStar::CoordinateList> future;
+        int priority;
+        bool started { false };
+    };
+
+    // queue entry, a job is queued again when a duplicate raises its priority and the stale entry skipped
+    struct Queued {
+        int priority;
+        uint64_t order;
+        shared_ptr<Job> job;
+
+        bool operator<(const Queued &other) const {
+            if (priority != other.priority) return priority < other.priority;
+            return order > other.order;
+        }
+    };
+
+    // a worker's AStar::Hierarchy, built on its own copy of the grid so that a new snapshot only
+    // rebuilds the clusters around the words that changed
+    struct Route {
+        AStar::Hierarchy hierarchy;
+        int width { -1 };
+        int height { -1 };
+        unsigned long long version { ~0ull };
+        vector<uint64_t> words;
+    };
+
+    const SolidGrid &grid;
+    mutex lock;
+    condition_variable wake;
+    vector<Queued> queue;
+    unordered_map<Key, shared_ptr<Job>, KeyHash> waiting;
+    shared_ptr<const Snapshot> snapshot;
+    uint64_t order { 0 };
+    bool stopping { false };
+    bool paused { false };
+    vector<thread> workers;
+
+    shared_ptr<const Snapshot> currentSnapshot() {
+        if (snapshot && snapshot->version == grid.getVersion()) return snapshot;
+        auto copy = make_shared<Snapshot>();
+        copy->width = grid.getWidth();
+        copy->height = grid.getHeight();
+        copy->rowWords = grid.getRowWords();
+        copy->version = grid.getVersion();
+        copy->words.assign(grid.data(), grid.data() + grid.wordCount());
+        snapshot = copy;
+        return snapshot;
+    }
+
+    static void search(AStar::Generator &generator, Job &job) {
+        auto &snapshot = *job.snapshot;
+        generator.setDiagonalMovement(job.options.diagonalMovement);
+        generator.setJumpPointSearch(job.options.jumpPointSearch);
+        generator.setHeuristic(job.options.diagonalMovement ? AStar::Heuristic::octagonal : AStar::Heuristic::manhattan);
+        generator.setCollisionGrid({ snapshot.words.data(), snapshot.rowWords });
+        job.result.set_value(generator.findPath(job.key.source, job.key.target));
+    }
+
+    static bool isRouted(AStar::Vec2i source, AStar::Vec2i target, const PathOptions &options) {
+        int distance = std::max(std::abs(target.x - source.x), std::abs(target.y - source.y));
+        return options.diagonalMovement && options.hierarchyRange > 0 && distance > options.hierarchyRange;
+    }
+
+    static void searchRoute(Route &route, Job &job) {
+        auto &snapshot = *job.snapshot;
+        if (route.width != snapshot.width || route.height != snapshot.height) {
+            route.width = snapshot.width;
+            route.height = snapshot.height;
+            route.words = snapshot.words;
+            route.hierarchy.setWorldSize({ snapshot.width, snapshot.height });
+            route.hierarchy.setCollisionGrid({ route.words.data(), snapshot.rowWords });
+        } else if (route.version != snapshot.version) {
+            for (size_t i = 0; i < route.words.size(); i++) {
+                if (route.words[i] == snapshot.words[i]) continue;
+                route.words[i] = snapshot.words[i];
+                int y = (int)(i / snapshot.rowWords);
+                int x = (int)(i % snapshot.rowWords) * 64;
+                route.hierarchy.invalidate({ x, y }, { std::min(x + 64, snapshot.width), y + 1 });
+            }
+        }
+        route.version = snapshot.version;
+        job.result.set_value(route.hierarchy.findPath(job.key.source, job.key.target));
+    }
+
+    void run() {
+        AStar::Generator generator;
+        AStar::Vec2i worldSize { -1, -1 };
+        Route route;
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [this] { return stopping || (!paused && !queue.empty()); });
+            if (stopping) return;
+            pop_heap(queue.begin(), queue.end());
+            auto job = std::move(queue.back().job);
+            queue.pop_back();
+            if (job->started) continue;
+            job->started = true;
+            waiting.erase(job->key);
+            guard.unlock();
+            if (job->key.options & 4) {
+                searchRoute(route, *job);
+                guard.lock();
+                continue;
+            }
+            if (worldSize.x != job->snapshot->width || worldSize.y != job->snapshot->height) {
+                worldSize = { job->snapshot->width, job->snapshot->height };
+                generator.setWorldSize(worldSize);
+            }
+            search(generator, *job);
+            guard.lock();
+        }
+    }
+public:
+    PathService(const SolidGrid &grid, int threads) : grid(grid) {
+        for (int i = 0; i < std::max(threads, 1); i++) {
+            workers.emplace_back(&PathService::run, this);
+        }
+    }
+
+    PathService(const PathService &) = delete;
+    PathService &operator=(const PathService &) = delete;
+
+    // Waits for the searches that are running, requests that did not start yet are dropped
+    ~PathService() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Asks for a path, higher priorities first. Call it from the thread that changes the grid, or while
+    // it does not change. Safe to call from any thread otherwise.
+    shared_future<AStar::CoordinateList> request(AStar::Vec2i source, AStar::Vec2i target, int priority = 0, PathOptions options = {}) {
+        Key key { source, target, (options.diagonalMovement ? 1 : 0) | (options.jumpPointSearch ? 2 : 0)
+            | (isRouted(source, target, options) ? 4 : 0) };
+        lock_guard<mutex> guard(lock);
+        auto found = waiting.find(key);
+        if (found != waiting.end()) {
+            auto &job = found->second;
+            job->snapshot = currentSnapshot();
+            if (priority > job->priority) {
+                job->priority = priority;
+                queue.push_back({ priority, order++, job });
+                push_heap(queue.begin(), queue.end());
+            }
+            return job->future;
+        }
+        auto job = make_shared<Job>();
+        job->key = key;
+        job->options = options;
+        job->snapshot = currentSnapshot();
+        job->future = job->result.get_future().share();
+        job->priority = priority;
+        waiting[key] = job;
+        queue.push_back({ priority, order++, job });
+        push_heap(queue.begin(), queue.end());
+        wake.notify_one();
+        return job->future;
+    }
+
+    // Holds back the requests that did not start yet, searches that are running finish. Requests made
+    // meanwhile are still answered together and by priority once resumed.
+    void pause() {
+        lock_guard<mutex> guard(lock);
+        paused = true;
+    }
+
+    void resume() {
+        {
+            lock_guard<mutex> guard(lock);
+            paused = false;
+        }
+        wake.notify_all();
+    }
+
+    [[nodiscard]] size_t getWaitingCount() {
+        lock_guard<mutex> guard(lock);
+        return waiting.size();
+    }
+};
+
+#endif //RENEGADE_ENGINE_PATHSERVICE_H
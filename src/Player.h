@@ -20,10 +20,10 @@ public:
     Vector2 position{};
     Vector2 direction{};
     Vector2 plane{};
-    int tile_x, tile_y;
+    int tile_x { 0 }, tile_y { 0 };
     Map* map;
-    shared_ptr<vector<int>> walls;
-    shared_ptr<vector<int>> lightmap;
+    LightmapView lightmap;
+    unsigned long long lightGeneration { 0 };
     float brightness = 0.0f;
 
     bool isMoving { false };
@@ -35,8 +35,7 @@ public:
 
     explicit Player(Map* map) {
         this->map = map;
-        this->walls = map->getWalls();
-        this->lightmap = map->getLightmap();
+        this->lightmap = map->getLightmap().view();
         this->currentMapWidth = map->getWidth();
         this->currentMapHeight = map->getHeight();
         this->rotation = 0.0f;
@@ -75,19 +74,23 @@ public:
     }
 
     void onMove() {
-        int index = (int)this->position.y * this->map->getWidth() + (int)this->position.x;
-        this->brightness = (float)this->map->getLightAt(index) / 255;
         this->isMoving = true;
 
         tile_x = (int)this->position.x;
         tile_y = (int)this->position.y;
+        this->updateBrightness();
+    }
+
+    void updateBrightness() {
+        int index = tile_y * this->currentMapWidth + tile_x;
+        this->brightness = (float)this->lightmap.intensityAt(index) / 255;
+        this->lightGeneration = this->lightmap.getGeneration();
     }
 
     void moveForward(float amount = 0.1f, float lookAhead = 0.6f) {
         int px = (int)(this->position.x + this->direction.x * lookAhead);
         int py = (int)(this->position.y + this->direction.y * lookAhead);
-        int index = py * this->currentMapHeight + px;
-        if ((*this->walls)[index] > 0) return;
+        if (this->map->isSolidAt(px, py)) return;
 
         this->position.x += this->direction.x * amount;
         this->position.y += this->direction.y * amount;
@@ -97,8 +100,7 @@ public:
     void moveBackward(float amount = 0.1f, float lookAhead = 0.6f) {
         int px = (int)(this->position.x - this->direction.x * lookAhead);
         int py = (int)(this->position.y - this->direction.y * lookAhead);
-        int index = py * this->currentMapWidth + px;
-        if ((*this->walls)[index] > 0) return;
+        if (this->map->isSolidAt(px, py)) return;
 
         this->position.x -= this->direction.x * amount;
         this->position.y -= this->direction.y * amount;
@@ -109,6 +111,14 @@ public:
         if (isMoving) {
             movingTime += dt;
         }
+        // pick up light changes (e.g. flickering lights) around the player without moving
+        if (this->lightGeneration != this->lightmap.getGeneration()) {
+            if (this->lightmap.dirtySince(this->lightGeneration).contains(tile_x, tile_y)) {
+                this->updateBrightness();
+            } else {
+                this->lightGeneration = this->lightmap.getGeneration();
+            }
+        }
     }
 };
 
@@ -15,14 +15,15 @@
 #include "Level.h"
 #include "Textures.h"
 #include "Process.h"
+#include "Light.h"
 
 struct Sprite {
     int id { 0 };
     Vector2 position { 0, 0 };
-    Texture2D texture;
+    TextureHandle texture;
     float distance { 0.0f };
 
-    Sprite(Vector2 pos, Texture2D &tex): texture(tex) {
+    Sprite(Vector2 pos, TextureHandle tex): texture(tex) {
         position = pos;
     }
 };
@@ -48,6 +49,31 @@ public:
     }
 };
 
+// Tile lookups of the render loops. The map type is resolved once per frame, so the loops
+// themselves are specialised for flat and streamed maps.
+struct FlatTileAccess {
+    const MapTiles &tiles;
+    int width;
+    int height;
+
+    inline bool fetch(int x, int y, ChunkCell &cell) const {
+        if ((unsigned)x >= (unsigned)width || (unsigned)y >= (unsigned)height) return false;
+        cell = tiles.cell(y * width + x);
+        return true;
+    }
+};
+
+struct ChunkTileAccess {
+    const ChunkedTiles &chunks;
+
+    inline bool fetch(int x, int y, ChunkCell &cell) const {
+        auto resident = chunks.cellAt(x, y);
+        if (resident == nullptr) return false;
+        cell = *resident;
+        return true;
+    }
+};
+
 struct LightSource {
     int x;
     int y;
@@ -58,16 +84,13 @@ struct LightSource {
 
 class Raycaster {
 private:
-    vector<int> floor;
-    vector<int> walls;
-    vector<int> ceiling;
-    vector<int> light;
-    vector<float> lightmap;
+    LightmapView lightmap;
+    ShadeLut floorShade;
 
     Player* player;
     Map* map;
     unique_ptr<Textures>& textures;
-    shared_ptr<Texture2D> atlasTexture;
+    TextureHandle atlas { NO_TEXTURE };
 
     vector<Sprite> static_sprites;
 
@@ -86,40 +109,34 @@ public:
         {
         this->player = player;
         this->map = map;
-        this->floor    = *(map->getFloor());
-        this->walls    = *(map->getWalls());
-        this->ceiling  = *(map->getCeiling());
-        this->light    = *(map->getLightmap());
-
-        this->lightmap = vector<float>(this->walls.size());
-        std::fill(this->lightmap.begin(), this->lightmap.end(), 0.1f);
+        this->lightmap = map->getLightmap().view();
 
         this->zBuffer = vector<double>(Config::DISPLAY_WIDTH);
-
-        this->assignLightMap();
     }
 
     void setAtlas(const string & name) {
-        this->atlasTexture = textures->get(name);
+        this->atlas = textures->handle(name);
     }
 
-    void assignLightMap() {
-        auto current_lightmap = *(this->map->getLightmap());
-        int i = 0;
-        for (auto &l : current_lightmap) {
-            if (l == 0) {
-                this->lightmap[i] = 0;
-            } else {
-                float lum = 1.0f / (128.0f / ((float)l));
-                this->lightmap[i] = lum;
-            }
-            i++;
-        }
+    void renderFloor() {
+        if (this->map->isStreaming()) this->renderFloor(ChunkTileAccess { this->map->getChunks() });
+        else this->renderFloor(FlatTileAccess { this->map->getTiles(), this->map->getWidth(), this->map->getHeight() });
     }
 
-    void renderFloor() {
+    void renderRaycaster() {
+        if (this->map->isStreaming()) this->renderRaycaster(ChunkTileAccess { this->map->getChunks() });
+        else this->renderRaycaster(FlatTileAccess { this->map->getTiles(), this->map->getWidth(), this->map->getHeight() });
+    }
+
+    template<typename TileAccess>
+    void renderFloor(const TileAccess &access) {
         int startY = Config::DISPLAY_HEIGHT / 2;
-        int mapWidth = this->map->getWidth();
+        ChunkCell cell {};
+        const int lightSubdivision = this->lightmap.subdivision;
+        const int lightWidth = this->lightmap.sampleWidth;
+        const int lightHeight = this->lightmap.sampleHeight;
+        const LightColor *lightSamples = this->lightmap.samples;
+        const Texture2D &atlasTexture = textures->get(atlas);
         for(int y = startY; y < Config::DISPLAY_HEIGHT; y++)
         {
             // rayDir for leftmost ray (x = 0) and rightmost ray (x = w)
@@ -149,6 +166,17 @@ public:
             float floorX = this->player->position.x + rowDistance * rayDirX0;
             float floorY = this->player->position.y + rowDistance * rayDirY0;
 
+            // light falls off with the row distance, which is constant for the whole row
+            floorShade.build(1.0f / rowDistance, global_illumination);
+
+            // light sample position in 16.16 fixed point, stepped along with floorX / floorY.
+            // 64 bit, 32 bits overflow from 32768 / lightSubdivision tiles on.
+            double lightScale = (double)lightSubdivision * 65536.0;
+            int64_t lightU = (int64_t)(floorX * lightScale);
+            int64_t lightV = (int64_t)(floorY * lightScale);
+            int64_t lightStepU = (int64_t)(floorStepX * lightScale);
+            int64_t lightStepV = (int64_t)(floorStepY * lightScale);
+
             for(int x = 0; x < Config::DISPLAY_WIDTH; ++x)
             {
                 // the cell coord is simply got from the integer parts of floorX and floorY
@@ -159,15 +187,22 @@ public:
                 int tx = (int)(Config::TEXTURE_SIZE * (floorX - cellX)) & (Config::TEXTURE_SIZE - 1);
                 int ty = (int)(Config::TEXTURE_SIZE * (floorY - cellY)) & (Config::TEXTURE_SIZE - 1);
 
+                int sampleX = (int)std::clamp<int64_t>(lightU >> 16, 0, lightWidth - 2);
+                int sampleY = (int)std::clamp<int64_t>(lightV >> 16, 0, lightHeight - 2);
+                int sampleFracX = (int)(lightU >> 8) & 0xFF;
+                int sampleFracY = (int)(lightV >> 8) & 0xFF;
+
                 floorX += floorStepX;
                 floorY += floorStepY;
+                lightU += lightStepU;
+                lightV += lightStepV;
 
-                int floorIndex = cellY * mapWidth + cellX;
-                int textureId = this->floor[floorIndex];
-                int ceilingTextureId = this->ceiling[floorIndex];
+                if (!access.fetch(cellX, cellY, cell)) continue;
+                int textureId = cell.floor;
+                int ceilingTextureId = cell.ceiling;
                 if (textureId <= 0) continue;
 
-                int atlasWidth = atlasTexture->width / Config::TEXTURE_SIZE;
+                int atlasWidth = atlasTexture.width / Config::TEXTURE_SIZE;
                 int textureIdX = textureId % atlasWidth;
                 int textureIdY = textureId / atlasWidth;
                 float textureX = textureIdX * Config::TEXTURE_SIZE + tx;
@@ -178,12 +213,15 @@ public:
                         static_cast<float>((ceilingTextureId / atlasWidth) * Config::TEXTURE_SIZE + ty)
                 };
 
-                unsigned char depth = this->light[floorIndex]; // y - Config::DISPLAY_HEIGHT / 2;
-                Color color { depth, depth, depth, 255 };
-                color = ColorBrightness(color, this->lightmap[floorIndex] / rowDistance + global_illumination);
+                // the tile's light level is the gray the light brightens, as with the walls
+                // (streamed chunks may reach past the lightmap)
+                bool onLightmap = (unsigned)cellX < (unsigned)this->lightmap.width && (unsigned)cellY < (unsigned)this->lightmap.height;
+                unsigned char floorDepth = onLightmap ? (unsigned char)this->lightmap.intensityAt(cellY * this->lightmap.width + cellX) : 0;
+                const LightColor *lightRow = &lightSamples[(size_t)sampleY * lightWidth + sampleX];
+                Color color = floorShade.shade(floorDepth, Light::bilinear(lightRow, lightRow + lightWidth, sampleFracX, sampleFracY));
 
                 DrawTexturePro(
-                        *atlasTexture,
+                        atlasTexture,
                         Rectangle { textureX, textureY, 1, 1 },
                         Rectangle { (float)x, (float)y, 1, 1 },
                         Vector2 { 0, 0 },
@@ -193,7 +231,7 @@ public:
 
                 if (ceilingTextureId <= 0) continue;
                 DrawTexturePro(
-                        *atlasTexture,
+                        atlasTexture,
                         Rectangle { ceilingTexturePos.x, ceilingTexturePos.y, 1, 1 },
                         Rectangle { (float)x, (float)Config::DISPLAY_HEIGHT - y, 1, 1 },
                         Vector2 { 0, 0 },
@@ -221,9 +259,12 @@ public:
         }
     }
 
-    void renderRaycaster() {
+    template<typename TileAccess>
+    void renderRaycaster(const TileAccess &access) {
         int mapWidth = this->map->getWidth();
-        float brightness = 0.5f;
+        const DistanceField &distances = this->map->getDistances();
+        const Texture2D &atlasTexture = textures->get(atlas);
+        ChunkCell cell {};
         for (int x = 0; x < Config::DISPLAY_WIDTH; x++) {
             double cameraX = 2 * x / double(Config::DISPLAY_WIDTH) - 1; //x-coordinate in camera space
             double rayDirX = this->player->direction.x + this->player->plane.x * cameraX;
@@ -265,10 +306,10 @@ public:
                 sideDistY = (mapY + 1.0 - this->player->position.y) * deltaDistY;
             }
 
-            int rayDepth = 0;
             int wallTextureId = -1;
             int mapIndex = 0;
-            while (rayDepth < 100)
+            // the map border is solid, so every ray ends at a wall or at the max ray distance
+            while (true)
             {
                 //jump to next map square, either in x-direction, or in y-direction
                 if (sideDistX < sideDistY) {
@@ -281,17 +322,25 @@ public:
                     side = 1;
                 }
                 mapIndex = mapY * mapWidth + mapX;
-                //Check if ray has hit a wall
-                // check hit light
-                if (mapIndex >= 0 && mapIndex < walls.size()) {
-                    if (walls[mapIndex] > 0) {
-                        wallTextureId = walls[mapIndex];
-                        break;
-                    }
+                //Check if ray has hit a wall, the map border and unknown parts of streamed maps are solid too
+                int wallDistance = distances.distance(mapX, mapY);
+                if (wallDistance == 0) {
+                    wallTextureId = access.fetch(mapX, mapY, cell) ? cell.wall : 0;
+                    hit = 1;
+                    break;
+                }
+                if (std::min(sideDistX, sideDistY) > Config::MAX_RAY_DISTANCE) break;
+                // far from any wall, jump to the border of the free square around this tile
+                if (wallDistance >= Config::RAY_SKIP_DISTANCE) {
+                    skipFreeSquare(wallDistance - 1, mapX, mapY, stepX, stepY, sideDistX, sideDistY, deltaDistX, deltaDistY);
                 }
-                rayDepth++;
             }
 
+            if(side == 0)
+                perpWallDist = (sideDistX - deltaDistX);
+            else
+                perpWallDist = (sideDistY - deltaDistY);
+
             //calculate value of wallX
             double wallX; //where exactly the wall was hit
             if (side == 0) wallX = this->player->position.y + perpWallDist * rayDirY;
@@ -303,40 +352,40 @@ public:
             if(side == 0 && rayDirX > 0) texX = Config::TEXTURE_SIZE - texX - 1;
             if(side == 1 && rayDirY < 0) texX = Config::TEXTURE_SIZE - texX - 1;
 
-            if(side == 0)
-                perpWallDist = (sideDistX - deltaDistX);
-            else
-                perpWallDist = (sideDistY - deltaDistY);
-
             //Calculate height of line to draw on screen
             int lineHeight = (int)(Config::DISPLAY_HEIGHT / perpWallDist);
 
             // set ZBuffer
             zBuffer[x] = perpWallDist;
+            if (!hit) continue;
 
             //calculate lowest and highest pixel to fill in current stripe
             double wallLightDist = perpWallDist;
             if (wallLightDist < 1) wallLightDist = 1;
             unsigned char wallDistDepth = 1 / wallLightDist * 255;
-            unsigned char wallDepth = this->light[mapIndex];
+            unsigned char wallDepth = std::min(this->lightmap.intensityAt(mapIndex), 255);
             if (wallDistDepth > wallDepth) wallDepth = wallDistDepth; // (1 / wallLightDist) * ((side == 1) ? 128 : 255);
             if (side == 1) wallDepth = wallDepth / 2;
             int drawStart = -lineHeight / 2 + Config::DISPLAY_HEIGHT / 2;
             // if(drawStart < 0)drawStart = 0;
             int drawEnd = lineHeight / 2 + Config::DISPLAY_HEIGHT / 2;
             // if(drawEnd >= Config::DISPLAY_HEIGHT)drawEnd = Config::DISPLAY_HEIGHT - 1;
-            Color color = ColorBrightness({ wallDepth, wallDepth, wallDepth, 255 }, this->lightmap[mapIndex] + global_illumination / (perpWallDist));
+            LightColor wallLight = this->lightmap.sample(
+                    (float)(this->player->position.x + perpWallDist * rayDirX),
+                    (float)(this->player->position.y + perpWallDist * rayDirY)
+            );
+            Color color = Light::shade(wallDepth, wallLight, 1.0f, global_illumination / (perpWallDist));
             // if (side == 1) color = GRAY;
 
             // DrawLine(x, drawStart, x, drawEnd, color);
-            int atlasWidth = atlasTexture->width / Config::TEXTURE_SIZE;
+            int atlasWidth = atlasTexture.width / Config::TEXTURE_SIZE;
             int textureIdX = wallTextureId % atlasWidth;
             int textureIdY = wallTextureId / atlasWidth;
             float textureX = textureIdX * Config::TEXTURE_SIZE + texX;
             float textureY = textureIdY * Config::TEXTURE_SIZE;
 
             DrawTexturePro(
-                    *atlasTexture,
+                    atlasTexture,
                     Rectangle { textureX, textureY, 1, Config::TEXTURE_SIZE },
                     Rectangle { (float)x, (float)drawStart, 1, float(drawEnd - drawStart) },
                     Vector2 { 0, 0 },
@@ -346,23 +395,36 @@ public:
         }
     }
 
+    // Takes every DDA step that stays inside the free square of the given radius around the current tile
+    // at once. Leaves the ray exactly where stepping tile by tile would have left it before the border.
+    static inline void skipFreeSquare(int radius, int &mapX, int &mapY, int stepX, int stepY,
+                                      double &sideDistX, double &sideDistY, double deltaDistX, double deltaDistY) {
+        // the first crossing that leaves the square
+        double exit = std::min(sideDistX + radius * deltaDistX, sideDistY + radius * deltaDistY);
+        int countX = std::clamp((int)std::ceil((exit - sideDistX) / deltaDistX), 0, radius);
+        int countY = std::clamp((int)std::ceil((exit - sideDistY) / deltaDistY), 0, radius);
+        mapX += countX * stepX;
+        mapY += countY * stepY;
+        sideDistX += countX * deltaDistX;
+        sideDistY += countY * deltaDistY;
+    }
+
     int addSprite(Sprite sprite) {
         sprite.id = lastSpriteId;
         this->static_sprites.emplace_back(sprite);
         return lastSpriteId++;
     }
 
-    void addFlickerLight(const int index) {
+    void addFlickerLight(const int index, LightColor color = Light::WHITE_LIGHT) {
         cout << "addFlickerLight: " << to_string(index) << endl;
-        FlickerProcess flicker(index, [this](int i, float v){
-            this->setLightMap(i, v);
+        FlickerProcess flicker(index, [this, color](int i, float v){
+            this->setLightMap(i, v, color);
         });
         this->process_list.emplace_back(make_unique<FlickerProcess>(flicker));
     }
 
-    void setLightMap(int index, float value) {
-        this->lightmap[index] = value;
-        this->map->setLight(index, value * 128);
+    void setLightMap(int index, float value, LightColor color = Light::WHITE_LIGHT) {
+        this->map->setLight(index, value * 128, color);
     }
 
     int addObject(GameObject &obj) {
@@ -372,18 +434,13 @@ public:
                 obj.position.x / Config::TEXTURE_SIZE,
                 obj.position.y / Config::TEXTURE_SIZE
         };
-        if (obj.type == "light") {
-            int index = (int)pos.y * map->getWidth() + (int)pos.x;
-            this->map->setLight(index, 128);
-        }
         if (obj.type == "light-flicker") {
             int index = (int)pos.y * map->getWidth() + (int)pos.x;
-            addFlickerLight(index);
+            addFlickerLight(index, Light::fromColor(obj.color));
         }
-        if (textures->exists(obj.name)) {
-            auto tex = textures->get(obj.name);
-            auto sprite = Sprite(pos, *tex);
-            spriteId = this->addSprite(sprite);
+        auto tex = textures->find(obj.name);
+        if (tex != NO_TEXTURE) {
+            spriteId = this->addSprite(Sprite(pos, tex));
         }
         return spriteId;
     }
@@ -398,7 +455,7 @@ public:
     }
 
     float getLightAt(int index) {
-        return this->lightmap[index];
+        return (float)this->lightmap.intensityAt(index) / 128.0f;
     }
 
     void drawSprites() {
@@ -420,7 +477,7 @@ public:
         sort(sprites.begin(), sprites.end(), [&](auto a, auto b){
             return a.distance > b.distance;
         });
-        for(int i = 0; i < sprites.size(); i++) {
+        for(size_t i = 0; i < sprites.size(); i++) {
             //translate sprite position to relative to camera
             double spriteX = sprites[i].position.x - player->position.x;
             double spriteY = sprites[i].position.y - player->position.y;
@@ -455,9 +512,17 @@ public:
             int drawEndX = spriteWidth / 2 + spriteScreenX;
             if (drawEndX >= Config::DISPLAY_WIDTH) drawEndX = Config::DISPLAY_WIDTH - 1;
 
+            int depth = (1 / sprites[i].distance) * 255;
+            if (depth > 255) depth = 255;
+            int spriteTileX = (int)sprites[i].position.x;
+            int spriteTileY = (int)sprites[i].position.y;
+            if (spriteTileX < 0 || spriteTileY < 0 || spriteTileX >= this->map->getWidth() || spriteTileY >= this->map->getHeight()) continue;
+            Color color = Light::shade((unsigned char)depth, this->lightmap.sample(sprites[i].position.x, sprites[i].position.y), 1.0f, 0.0f);
+            const Texture2D &spriteTexture = textures->get(sprites[i].texture);
+
             //loop through every vertical stripe of the sprite on screen
             for (int stripe = drawStartX; stripe < drawEndX; stripe++) {
-                int texX = int(256 * (stripe - (-spriteWidth / 2 + spriteScreenX)) * sprites[i].texture.width /
+                int texX = int(256 * (stripe - (-spriteWidth / 2 + spriteScreenX)) * spriteTexture.width /
                                spriteWidth) / 256;
                 //the conditions in the if are:
                 //1) it's in front of camera plane so you don't see things behind you
@@ -469,18 +534,10 @@ public:
                     {
                         int d = (y) * 256 - Config::DISPLAY_HEIGHT * 128 +
                                 spriteHeight * 128; //256 and 128 factors to avoid floats
-                        int texY = ((d * sprites[i].texture.height) / spriteHeight) / 256;
-
-                        int depth = (1 / sprites[i].distance) * 255;
-                        if (depth > 255) depth = 255;
-
-                        Color color { (unsigned char)depth, (unsigned char)depth, (unsigned char)depth, 255 };
-                        int mapIndex = (int)sprites[i].position.y * this->map->getWidth() + (int)sprites[i].position.x;
-                        if (mapIndex < 0 || mapIndex > this->walls.size()) continue;
-                        color = ColorBrightness(color, this->lightmap[mapIndex]);
+                        int texY = ((d * spriteTexture.height) / spriteHeight) / 256;
 
                         DrawTexturePro(
-                                sprites[i].texture,
+                                spriteTexture,
                                 Rectangle{(float) texX, (float) texY, 1, 1},
                                 Rectangle{(float)stripe, (float)y, 1, 1},
                                 Vector2{0, 0},
@@ -0,0 +1,211 @@
+#ifndef RENEGADE_ENGINE_SOLIDGRID_H
+#define RENEGADE_ENGINE_SOLIDGRID_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include "DirtyRect.h"
+
+using namespace std;
+
+// One bit per tile, set for tiles nothing can pass (walls). Rows are padded to whole 64 bit words, so a
+// cache line holds 512 tiles of a row and row / rectangle queries test 64 tiles at a time.
+// Everything outside the grid is solid. Not synchronized, writers and readers on different threads
+// need a lock of their own (see Map::lockGrid), only the version can be read at any time.
+class SolidGrid {
+public:
+    static constexpr int WORD_BITS = 64;
+    static constexpr int HISTORY_SIZE = 64;
+private:
+    struct Change {
+        unsigned long long version;
+        DirtyRect rect;
+    };
+
+    int width;
+    int height;
+    int rowWords;
+    // owned, or external memory (e.g. a mapped cooked level)
+    vector<uint64_t> ownedWords;
+    uint64_t *words;
+    // bumped on every change
+    atomic<unsigned long long> version { 0 };
+    // the tiles of the last HISTORY_SIZE changes, by version
+    array<Change, HISTORY_SIZE> history {};
+
+    void changed(DirtyRect rect) {
+        auto next = version.load(memory_order_relaxed) + 1;
+        this->history[next % HISTORY_SIZE] = { next, rect };
+        version.store(next, memory_order_release);
+    }
+
+    // bits [from, to) of a word, to <= 64
+    static inline uint64_t bitRange(int from, int to) {
+        uint64_t upper = to >= WORD_BITS ? ~0ull : (1ull << to) - 1;
+        return upper & ~((1ull << from) - 1);
+    }
+
+    // setBits without recording the change, true if a tile changed
+    bool writeBits(int x, int y, uint64_t bits, int count) {
+        if ((unsigned)y >= (unsigned)height) return false;
+        uint64_t *row = &words[(size_t)y * rowWords];
+        uint64_t difference = 0;
+        for (int i = 0; i < count;) {
+            int tx = x + i;
+            if (tx >= width) break;
+            if (tx < 0) {
+                i++;
+                continue;
+            }
+            int offset = tx & 63;
+            int n = std::min({ count - i, WORD_BITS - offset, width - tx });
+            uint64_t mask = bitRange(offset, offset + n);
+            uint64_t value = ((bits >> i) << offset) & mask;
+            difference |= (row[tx >> 6] & mask) ^ value;
+            row[tx >> 6] = (row[tx >> 6] & ~mask) | value;
+            i += n;
+        }
+        return difference != 0;
+    }
+public:
+    SolidGrid(int width, int height, bool solid = false) : width(width), height(height) {
+        this->rowWords = wordsPerRow(width);
+        this->ownedWords = vector<uint64_t>((size_t)rowWords * height, 0);
+        this->words = ownedWords.data();
+        if (solid) {
+            for (int y = 0; y < height; y++) {
+                this->setRange(y, 0, width, true);
+            }
+        }
+    }
+
+    // Uses wordsPerRow(width) * height words at the given memory in place, they must outlive the grid
+    SolidGrid(int width, int height, uint64_t *external) : width(width), height(height), words(external) {
+        this->rowWords = wordsPerRow(width);
+    }
+
+    SolidGrid(const SolidGrid &) = delete;
+    SolidGrid &operator=(const SolidGrid &) = delete;
+
+    static int wordsPerRow(int width) {
+        return (width + WORD_BITS - 1) / WORD_BITS;
+    }
+
+    [[nodiscard]] inline bool isSolid(int x, int y) const {
+        if ((unsigned)x >= (unsigned)width || (unsigned)y >= (unsigned)height) return true;
+        return (words[(size_t)y * rowWords + (x >> 6)] >> (x & 63)) & 1;
+    }
+
+    void set(int x, int y, bool solid) {
+        if ((unsigned)x >= (unsigned)width || (unsigned)y >= (unsigned)height) return;
+        uint64_t &word = words[(size_t)y * rowWords + (x >> 6)];
+        uint64_t bit = 1ull << (x & 63);
+        word = solid ? word | bit : word & ~bit;
+        changed({ x, y, x + 1, y + 1 });
+    }
+
+    // Sets or clears the tiles [x0, x1) of a row
+    void setRange(int y, int x0, int x1, bool solid) {
+        if ((unsigned)y >= (unsigned)height) return;
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, width);
+        uint64_t *row = &words[(size_t)y * rowWords];
+        for (int x = x0; x < x1;) {
+            int wordEnd = std::min((x & ~63) + WORD_BITS, x1);
+            uint64_t mask = bitRange(x & 63, wordEnd - (x & ~63));
+            row[x >> 6] = solid ? row[x >> 6] | mask : row[x >> 6] & ~mask;
+            x = wordEnd;
+        }
+        changed({ x0, y, x1, y + 1 });
+    }
+
+    // Writes count (<= 64) bits of a row starting at x, bit 0 is the tile at x
+    void setBits(int x, int y, uint64_t bits, int count) {
+        if (writeBits(x, y, bits, count)) changed({ x, y, x + count, y + 1 });
+    }
+
+    // Writes count (<= 64) bits of rowCount rows starting at x, y as one change, e.g. a streamed chunk.
+    // Nothing changes if the tiles are the same already.
+    void setBlock(int x, int y, const uint64_t *rows, int rowCount, int count) {
+        bool any = false;
+        for (int i = 0; i < rowCount; i++) {
+            any |= writeBits(x, y + i, rows[i], count);
+        }
+        if (any) changed({ x, y, x + count, y + rowCount });
+    }
+
+    // Appends the tiles changed after the given version, possibly overlapping. False if the grid
+    // changed more often than the recorded history since then.
+    bool changesSince(unsigned long long since, vector<DirtyRect> &rects) const {
+        auto current = getVersion();
+        if (since >= current) return true;
+        if (current - since > HISTORY_SIZE) return false;
+        for (auto v = since + 1; v <= current; v++) {
+            auto &change = this->history[v % HISTORY_SIZE];
+            if (change.version != v) return false;
+            rects.push_back(change.rect);
+        }
+        return true;
+    }
+
+    // First solid tile in [x0, x1) of a row, or x1 if they are all free. Tiles outside the grid are solid
+    // like everywhere else, so a range reaching past it always has a hit.
+    [[nodiscard]] int findSolid(int y, int x0, int x1) const {
+        if (x0 >= x1) return x1;
+        if ((unsigned)y >= (unsigned)height || x0 < 0) return x0;
+        int end = std::min(x1, width);
+        const uint64_t *row = &words[(size_t)y * rowWords];
+        for (int x = x0; x < end;) {
+            int wordStart = x & ~63;
+            int wordEnd = std::min(wordStart + WORD_BITS, end);
+            uint64_t hits = row[x >> 6] & bitRange(x & 63, wordEnd - wordStart);
+            if (hits) return wordStart + __builtin_ctzll(hits);
+            x = wordEnd;
+        }
+        return x1 > width ? std::max(x0, width) : x1;
+    }
+
+    [[nodiscard]] bool isRowEmpty(int y, int x0, int x1) const {
+        return findSolid(y, x0, x1) >= x1;
+    }
+
+    // True if no tile in [x0, x1) x [y0, y1) is solid
+    [[nodiscard]] bool isRectEmpty(int x0, int y0, int x1, int y1) const {
+        for (int y = y0; y < y1; y++) {
+            if (!isRowEmpty(y, x0, x1)) return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] const uint64_t *data() const {
+        return words;
+    }
+
+    [[nodiscard]] size_t wordCount() const {
+        return (size_t)rowWords * height;
+    }
+
+    [[nodiscard]] int getRowWords() const {
+        return rowWords;
+    }
+
+    [[nodiscard]] unsigned long long getVersion() const {
+        return version.load(memory_order_acquire);
+    }
+
+    [[nodiscard]] size_t memoryFootprint() const {
+        return ownedWords.capacity() * sizeof(uint64_t);
+    }
+
+    [[nodiscard]] int getWidth() const {
+        return width;
+    }
+
+    [[nodiscard]] int getHeight() const {
+        return height;
+    }
+};
+
+#endif //RENEGADE_ENGINE_SOLIDGRID_H
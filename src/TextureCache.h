@@ -0,0 +1,212 @@
+#ifndef RENEGADE_ENGINE_TEXTURECACHE_H
+#define RENEGADE_ENGINE_TEXTURECACHE_H
+
+#include <raylib.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include "MappedFile.h"
+#include "Hash.h"
+
+using namespace std;
+
+// Decoded images as raylib holds them in memory (pixel format and mip levels included), one file per
+// source image. An entry is used while its source has the recorded size and modification time, or the
+// same contents when only the time changed (fresh checkout). Entries are mapped and uploaded from the
+// mapping, images that had to be decoded are written by a background thread.
+class TextureCache {
+public:
+    static constexpr char MAGIC[4] = { 'R', 'T', 'E', 'X' };
+    static constexpr uint32_t VERSION = 1;
+    // start of the pixels, keeps them aligned for the upload
+    static constexpr size_t DATA_OFFSET = 64;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint64_t sourceHash;
+        int32_t width;
+        int32_t height;
+        int32_t mipmaps;
+        int32_t format;
+        uint64_t dataSize;
+    };
+    static_assert(sizeof(Header) <= DATA_OFFSET, "texture cache header overlaps the pixels");
+
+    // A mapped entry, the image points into the mapping and lives as long as it
+    struct Entry {
+        unique_ptr<MappedFile> file;
+        Image image {};
+    };
+private:
+    struct Pending {
+        string sourcePath;
+        Header header;
+        vector<unsigned char> pixels;
+    };
+
+    string directory;
+    mutex lock;
+    condition_variable wake;
+    deque<Pending> pending;
+    bool stopping { false };
+    thread writer;
+
+    string entryPath(const string &sourcePath) const {
+        Hash hash;
+        hash.add(sourcePath.data(), sourcePath.size());
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.rtex", (unsigned long long)hash.get());
+        return (filesystem::path(directory) / name).string();
+    }
+
+    static bool sourceInfo(const string &sourcePath, uint64_t &size, int64_t &time) {
+        error_code error;
+        size = filesystem::file_size(sourcePath, error);
+        if (error) return false;
+        auto writeTime = filesystem::last_write_time(sourcePath, error);
+        if (error) return false;
+        time = (int64_t)writeTime.time_since_epoch().count();
+        return true;
+    }
+
+    static uint64_t hashContents(const string &sourcePath) {
+        MappedFile file(sourcePath);
+        Hash hash;
+        if (file.isOpen()) hash.add(file.data(), file.size());
+        return hash.get();
+    }
+
+    // Bytes of the pixels with all mip levels
+    static size_t dataSize(int width, int height, int mipmaps, int format) {
+        size_t size = 0;
+        for (int level = 0; level < mipmaps; level++) {
+            size += (size_t)GetPixelDataSize(width, height, format);
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+        return size;
+    }
+
+    // Writes an entry next to the old one and moves it over, readers that mapped the old one keep it and
+    // never see a half written one. The writer thread and a load touching an entry may write the same
+    // entry at the same time, each uses its own file.
+    void writeEntry(const string &sourcePath, const Header &header, const unsigned char *pixels) const {
+        auto path = entryPath(sourcePath);
+        auto temporary = path + ".tmp" + to_string(hash<thread::id>()(this_thread::get_id()));
+        error_code error;
+        filesystem::create_directories(directory, error);
+        {
+            ofstream file(temporary, ios::binary | ios::trunc);
+            char padding[DATA_OFFSET] {};
+            memcpy(padding, &header, sizeof(Header));
+            if (!file || !file.write(padding, DATA_OFFSET)
+                || !file.write((const char *)pixels, (streamsize)header.dataSize)) {
+                cout << "WARNING: could not write texture cache - " << path << endl;
+                file.close();
+                filesystem::remove(temporary, error);
+                return;
+            }
+        }
+        filesystem::rename(temporary, path, error);
+        if (error) {
+            cout << "WARNING: could not write texture cache - " << path << endl;
+            filesystem::remove(temporary, error);
+        }
+    }
+
+    void write(Pending &entry) const {
+        entry.header.sourceHash = hashContents(entry.sourcePath);
+        writeEntry(entry.sourcePath, entry.header, entry.pixels.data());
+    }
+
+    void runWriter() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) return;
+            auto entry = std::move(pending.front());
+            pending.pop_front();
+            guard.unlock();
+            write(entry);
+            guard.lock();
+        }
+    }
+public:
+    explicit TextureCache(string directory) : directory(std::move(directory)) {}
+
+    TextureCache(const TextureCache &) = delete;
+    TextureCache &operator=(const TextureCache &) = delete;
+
+    // Finishes the entries that are still being written
+    ~TextureCache() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (writer.joinable()) writer.join();
+    }
+
+    // The cached image of a source file, if there is an entry that is still valid. Safe to call from any thread.
+    bool load(const string &sourcePath, Entry &entry) const {
+        uint64_t size;
+        int64_t time;
+        if (!sourceInfo(sourcePath, size, time)) return false;
+        auto file = make_unique<MappedFile>(entryPath(sourcePath));
+        if (!file->isOpen() || file->size() < DATA_OFFSET) return false;
+        Header header {};
+        memcpy(&header, file->data(), sizeof(Header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.sourceSize != size) return false;
+        if (header.width <= 0 || header.height <= 0 || header.mipmaps <= 0
+            || header.dataSize != file->size() - DATA_OFFSET
+            || header.dataSize != dataSize(header.width, header.height, header.mipmaps, header.format)) return false;
+        if (header.sourceTime != time) {
+            if (header.sourceHash != hashContents(sourcePath)) return false;
+            // same contents with a new time, recorded so that later starts don't hash the source again
+            header.sourceTime = time;
+            writeEntry(sourcePath, header, file->data() + DATA_OFFSET);
+        }
+        entry.image = Image { file->data() + DATA_OFFSET, header.width, header.height, header.mipmaps, header.format };
+        entry.file = std::move(file);
+        return true;
+    }
+
+    // Copies a decoded image and writes it to the cache in the background. Safe to call from any thread.
+    void store(const string &sourcePath, const Image &image) {
+        if (image.data == nullptr || image.width <= 0 || image.height <= 0) return;
+        Pending entry;
+        entry.sourcePath = sourcePath;
+        entry.header = {};
+        memcpy(entry.header.magic, MAGIC, sizeof(MAGIC));
+        entry.header.version = VERSION;
+        if (!sourceInfo(sourcePath, entry.header.sourceSize, entry.header.sourceTime)) return;
+        entry.header.width = image.width;
+        entry.header.height = image.height;
+        entry.header.mipmaps = std::max(image.mipmaps, 1);
+        entry.header.format = image.format;
+        entry.header.dataSize = dataSize(image.width, image.height, entry.header.mipmaps, image.format);
+        auto pixels = (const unsigned char *)image.data;
+        entry.pixels.assign(pixels, pixels + entry.header.dataSize);
+        {
+            lock_guard<mutex> guard(lock);
+            pending.push_back(std::move(entry));
+            if (!writer.joinable()) writer = thread(&TextureCache::runWriter, this);
+        }
+        wake.notify_one();
+    }
+};
+
+#endif //RENEGADE_ENGINE_TEXTURECACHE_H
@@ -0,0 +1,101 @@
+#ifndef RENEGADE_ENGINE_TEXTUREDECODER_H
+#define RENEGADE_ENGINE_TEXTUREDECODER_H
+
+#include <raylib.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "AssetManifest.h"
+#include "Textures.h"
+#include "TextureCache.h"
+
+using namespace std;
+
+// Decodes images listed in a manifest on worker threads. Uploading needs the GL context, so the main thread
+// calls upload() between frames and every image that is decoded by then becomes a texture. With a cache,
+// images come from there when they can and the others are added to it.
+class TextureDecoder {
+private:
+    struct Slot {
+        AssetManifest::Entry entry;
+        Image image {};
+        // the image is in here instead of raylib's memory when it came from the cache
+        TextureCache::Entry cached;
+        atomic<bool> decoded { false };
+        bool uploaded { false };
+    };
+
+    unique_ptr<Slot[]> slots;
+    size_t count { 0 };
+    size_t uploaded { 0 };
+    atomic<size_t> next { 0 };
+    TextureCache *cache;
+    vector<thread> workers;
+
+    void decode() {
+        for (size_t i = next++; i < count; i = next++) {
+            auto &slot = slots[i];
+            if (cache != nullptr && cache->load(slot.entry.path, slot.cached)) {
+                slot.image = slot.cached.image;
+            } else {
+                slot.image = LoadImage(slot.entry.path.c_str());
+                if (cache != nullptr) cache->store(slot.entry.path, slot.image);
+            }
+            slot.decoded = true;
+        }
+    }
+
+    static void release(Slot &slot) {
+        if (slot.cached.file) slot.cached.file.reset();
+        else UnloadImage(slot.image);
+    }
+public:
+    explicit TextureDecoder(const vector<AssetManifest::Entry> &entries, TextureCache *cache = nullptr) : cache(cache) {
+        this->count = entries.size();
+        this->slots = make_unique<Slot[]>(count);
+        for (size_t i = 0; i < count; i++) {
+            slots[i].entry = entries[i];
+        }
+        size_t threads = std::min<size_t>(std::max(thread::hardware_concurrency(), 1u), count);
+        for (size_t i = 0; i < threads; i++) {
+            workers.emplace_back(&TextureDecoder::decode, this);
+        }
+    }
+
+    TextureDecoder(const TextureDecoder &) = delete;
+    TextureDecoder &operator=(const TextureDecoder &) = delete;
+
+    ~TextureDecoder() {
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (!slots[i].uploaded) release(slots[i]);
+        }
+    }
+
+    // Uploads the images decoded so far in manifest order, call it from the thread that owns the GL context
+    void upload(Textures &textures) {
+        for (size_t i = 0; i < count; i++) {
+            auto &slot = slots[i];
+            if (slot.uploaded || !slot.decoded) continue;
+            textures.add(slot.entry.name, slot.image);
+            release(slot);
+            slot.uploaded = true;
+            uploaded++;
+        }
+    }
+
+    [[nodiscard]] bool isDone() const {
+        return uploaded == count;
+    }
+
+    [[nodiscard]] float getProgress() const {
+        return count > 0 ? (float)uploaded / (float)count : 1.0f;
+    }
+};
+
+#endif //RENEGADE_ENGINE_TEXTUREDECODER_H
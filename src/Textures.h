@@ -2,48 +2,231 @@
 #define RENEGADE_ENGINE_TEXTURES_H
 
 #include <raylib.h>
-#include <map>
 #include <string>
+#include <vector>
+#include <iostream>
+#include <unordered_map>
+#include <stdexcept>
+#include "AssetManifest.h"
 
 using namespace std;
 
+// Index of a texture in Textures, stays the same until the texture is removed
+using TextureHandle = int;
+constexpr TextureHandle NO_TEXTURE = -1;
+
+// Textures by name. Names are looked up once when a texture is registered or a level is set up, the
+// render loops keep handles and resolve them with get(), which is an array index.
+//
+// Textures from the manifest are declared first and loaded by whoever calls getMissing(). Level textures
+// are only wanted while a level holds a reference to them (see TextureSet). Once no level uses them they
+// stay loaded until evict() needs the room for the budget, least recently used first, so walking back and
+// forth between levels does not reload them. All other textures are loaded once and kept.
 class Textures {
 private:
-    map<string, Texture2D> texture_map;
+    struct Residency {
+        string name;
+        string path;
+        bool loaded { false };
+        // unloaded by evict() when it is not referenced
+        bool evictable { false };
+        int references { 0 };
+        uint64_t lastUsed { 0 };
+        size_t bytes { 0 };
+    };
+
+    // kept apart from the residency so that get() stays a lookup in a dense array
+    vector<Texture2D> textures;
+    vector<Residency> residency;
+    unordered_map<string, TextureHandle> handles;
+    // slots of removed textures, reused by the next add
+    vector<TextureHandle> freeHandles;
+    size_t budget;
+    size_t evictableBytes { 0 };
+    uint64_t clock { 0 };
+
+    TextureHandle insert(const string &name, const string &path) {
+        TextureHandle handle;
+        if (!freeHandles.empty()) {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+        } else {
+            handle = (TextureHandle)textures.size();
+            textures.emplace_back();
+            residency.emplace_back();
+        }
+        textures[handle] = Texture2D {};
+        residency[handle] = Residency {};
+        residency[handle].name = name;
+        residency[handle].path = path;
+        handles[name] = handle;
+        return handle;
+    }
 
+    TextureHandle store(const string &name, const string &path, Texture2D texture) {
+        auto handle = find(name);
+        if (handle == NO_TEXTURE) handle = insert(name, path);
+        auto &resident = residency[handle];
+        if (resident.loaded) {
+            UnloadTexture(texture);
+            return handle;
+        }
+        textures[handle] = texture;
+        resident.loaded = true;
+        resident.bytes = (size_t)GetPixelDataSize(texture.width, texture.height, texture.format);
+        if (resident.evictable) evictableBytes += resident.bytes;
+        return handle;
+    }
+
+    void unload(TextureHandle handle) {
+        auto &resident = residency[handle];
+        if (!resident.loaded) return;
+        UnloadTexture(textures[handle]);
+        textures[handle] = Texture2D {};
+        if (resident.evictable) evictableBytes -= resident.bytes;
+        resident.loaded = false;
+        resident.bytes = 0;
+    }
 public:
-    Textures() = default;
+    // budget: bytes of level textures that may stay loaded
+    explicit Textures(size_t budget = SIZE_MAX) : budget(budget) {}
+
+    Textures(const Textures &) = delete;
+    Textures &operator=(const Textures &) = delete;
 
-    void add(string path, string name) {
-        if (texture_map.count(name)) return;
-        texture_map.insert(pair<string, Texture2D>( name, LoadTexture(path.c_str()) ));
+    // Registers a manifest entry without loading it
+    TextureHandle declare(const AssetManifest::Entry &entry) {
+        auto handle = find(entry.name);
+        if (handle != NO_TEXTURE) return handle;
+        handle = insert(entry.name, entry.path);
+        residency[handle].evictable = entry.perLevel;
+        return handle;
     }
 
-    shared_ptr<Texture2D> get(string name) {
-        if (!texture_map.count(name)) {
-            string error = "Could not find texture: " + name;
-            throw runtime_error(error.c_str());
+    TextureHandle add(const string &path, const string &name) {
+        auto found = find(name);
+        if (found != NO_TEXTURE && residency[found].loaded) return found;
+        return store(name, path, LoadTexture(path.c_str()));
+    }
+
+    // Uploads an image decoded elsewhere, the image stays with the caller
+    TextureHandle add(const string &name, const Image &image) {
+        auto found = find(name);
+        if (found != NO_TEXTURE && residency[found].loaded) return found;
+        return store(name, "", LoadTextureFromImage(image));
+    }
+
+    // The handle of a texture or NO_TEXTURE
+    [[nodiscard]] TextureHandle find(const string &name) const {
+        auto found = handles.find(name);
+        return found != handles.end() ? found->second : NO_TEXTURE;
+    }
+
+    [[nodiscard]] TextureHandle handle(const string &name) const {
+        auto found = find(name);
+        if (found == NO_TEXTURE) throw runtime_error("Could not find texture: " + name);
+        return found;
+    }
+
+    [[nodiscard]] const Texture2D &get(TextureHandle handle) const {
+        return textures[handle];
+    }
+
+    // A level uses the texture, it is wanted until it is released again
+    TextureHandle acquire(const string &name) {
+        auto handle = find(name);
+        if (handle == NO_TEXTURE) return NO_TEXTURE;
+        residency[handle].references++;
+        residency[handle].lastUsed = ++clock;
+        return handle;
+    }
+
+    void release(TextureHandle handle) {
+        if (handle == NO_TEXTURE || residency[handle].references == 0) return;
+        residency[handle].references--;
+        residency[handle].lastUsed = ++clock;
+    }
+
+    // Declared textures that are wanted but not loaded: everything that is not a level texture, and the
+    // level textures that are referenced
+    [[nodiscard]] vector<AssetManifest::Entry> getMissing() const {
+        vector<AssetManifest::Entry> missing;
+        for (auto &resident : residency) {
+            if (resident.loaded || resident.name.empty() || resident.path.empty()) continue;
+            if (!resident.evictable || resident.references > 0) missing.push_back({ resident.name, resident.path, resident.evictable });
+        }
+        return missing;
+    }
+
+    // Unloads level textures nobody references, least recently used first, until they fit the budget
+    void evict() {
+        while (evictableBytes > budget) {
+            TextureHandle oldest = NO_TEXTURE;
+            for (TextureHandle handle = 0; handle < (TextureHandle)residency.size(); handle++) {
+                auto &resident = residency[handle];
+                if (!resident.loaded || !resident.evictable || resident.references > 0) continue;
+                if (oldest == NO_TEXTURE || resident.lastUsed < residency[oldest].lastUsed) oldest = handle;
+            }
+            if (oldest == NO_TEXTURE) {
+                cout << "WARNING: level textures need " << evictableBytes << " bytes, more than the budget of " << budget << endl;
+                return;
+            }
+            unload(oldest);
         }
-        return make_shared<Texture2D>(texture_map[name]);
     }
 
-    void remove(string name) {
-        if (!texture_map.count(name)) return;
-        auto texture = texture_map[name];
-        UnloadTexture(texture);
-        texture_map.erase(name);
+    [[nodiscard]] bool isLoaded(TextureHandle handle) const {
+        return handle != NO_TEXTURE && residency[handle].loaded;
     }
 
-    bool exists(string name) {
-        return texture_map.count(name);
+    [[nodiscard]] size_t getEvictableBytes() const {
+        return evictableBytes;
+    }
+
+    void remove(const string &name) {
+        auto found = handles.find(name);
+        if (found == handles.end()) return;
+        unload(found->second);
+        residency[found->second] = Residency {};
+        freeHandles.push_back(found->second);
+        handles.erase(found);
+    }
+
+    [[nodiscard]] bool exists(const string &name) const {
+        return handles.count(name) > 0;
     }
 
     ~Textures() {
-        for (auto &pair : texture_map) {
-            auto texture = pair.second;
-            UnloadTexture(texture);
+        for (TextureHandle handle = 0; handle < (TextureHandle)residency.size(); handle++) {
+            unload(handle);
+        }
+        handles.clear();
+        textures.clear();
+        residency.clear();
+    }
+};
+
+// The references a level holds on the textures its objects use, released with the level. Released
+// textures stay loaded until the next evict(), so the next level picks up the ones it shares.
+class TextureSet {
+private:
+    Textures &textures;
+    vector<TextureHandle> handles;
+public:
+    TextureSet(Textures &textures, const vector<string> &names) : textures(textures) {
+        for (auto &name : names) {
+            auto handle = textures.acquire(name);
+            if (handle != NO_TEXTURE) handles.push_back(handle);
+        }
+    }
+
+    TextureSet(const TextureSet &) = delete;
+    TextureSet &operator=(const TextureSet &) = delete;
+
+    ~TextureSet() {
+        for (auto handle : handles) {
+            textures.release(handle);
         }
-        texture_map.clear();
     }
 };
 
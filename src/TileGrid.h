@@ -0,0 +1,225 @@
+#ifndef RENEGADE_ENGINE_TILEGRID_H
+#define RENEGADE_ENGINE_TILEGRID_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <string>
+
+using namespace std;
+
+enum class TileLayout {
+    // one array per layer, best for loops touching a single layer (e.g. the DDA)
+    StructOfArrays,
+    // one struct per cell, a single load brings in every layer of a cell
+    Interleaved
+};
+
+namespace TileFlags {
+    constexpr uint8_t SOLID = 1 << 0;
+}
+
+enum class TileLayer {
+    Wall,
+    Floor,
+    Ceiling
+};
+
+template<typename TileId>
+struct TileCell {
+    TileId wall;
+    TileId floor;
+    TileId ceiling;
+    uint8_t flags;
+};
+
+// Read-only view of one layer of a TileGrid, no matter how the grid is laid out. Views never copy, they
+// always see the live tiles and carry the grid's version stamp to detect changes.
+template<typename TileId>
+class TileLayerView {
+private:
+    const unsigned char *base { nullptr };
+    size_t stride { 0 };
+    size_t count { 0 };
+    const unsigned long long *version { nullptr };
+public:
+    TileLayerView() = default;
+
+    TileLayerView(const TileId *first, size_t stride, size_t count, const unsigned long long *version)
+        : base((const unsigned char *)first), stride(stride), count(count), version(version) {}
+
+    [[nodiscard]] inline TileId operator[](size_t index) const {
+        return *(const TileId *)(base + index * stride);
+    }
+
+    [[nodiscard]] inline size_t size() const {
+        return count;
+    }
+
+    [[nodiscard]] inline unsigned long long getVersion() const {
+        return *version;
+    }
+};
+
+// Tile ids as used by the renderer, 0 means "no tile" (Tiled's empty -1 is stored as 0 as well)
+template<TileLayout Layout, typename TileId = uint16_t>
+class TileGrid {
+private:
+    int width;
+    int height;
+    // StructOfArrays
+    vector<TileId> walls;
+    vector<TileId> floors;
+    vector<TileId> ceilings;
+    vector<uint8_t> flags;
+    // Interleaved, the cells are either owned or live in external memory (e.g. a mapped cooked level)
+    vector<TileCell<TileId>> ownedCells;
+    TileCell<TileId> *cells { nullptr };
+    // bumped on every change
+    unsigned long long version { 0 };
+
+    static TileId toTileId(int value) {
+        if (value > std::numeric_limits<TileId>::max()) {
+            throw runtime_error("Tile id " + to_string(value) + " does not fit the tile id type");
+        }
+        return (TileId)std::max(value, 0);
+    }
+public:
+    TileGrid(int width, int height) : width(width), height(height) {
+        size_t size = width * height;
+        if constexpr (Layout == TileLayout::StructOfArrays) {
+            walls = vector<TileId>(size, 0);
+            floors = vector<TileId>(size, 0);
+            ceilings = vector<TileId>(size, 0);
+            flags = vector<uint8_t>(size, 0);
+        } else {
+            ownedCells = vector<TileCell<TileId>>(size, TileCell<TileId> { 0, 0, 0, 0 });
+            cells = ownedCells.data();
+        }
+    }
+
+    // Uses width * height cells at the given memory in place, they must outlive the grid
+    TileGrid(int width, int height, TileCell<TileId> *external) : width(width), height(height), cells(external) {
+        if constexpr (Layout != TileLayout::Interleaved) {
+            throw runtime_error("Only interleaved tile grids can use external cells");
+        }
+    }
+
+    TileGrid(const TileGrid &) = delete;
+    TileGrid &operator=(const TileGrid &) = delete;
+
+    [[nodiscard]] inline size_t size() const {
+        return (size_t)width * height;
+    }
+
+    [[nodiscard]] inline TileId wall(int index) const {
+        if constexpr (Layout == TileLayout::StructOfArrays) return walls[index];
+        else return cells[index].wall;
+    }
+
+    [[nodiscard]] inline TileId floor(int index) const {
+        if constexpr (Layout == TileLayout::StructOfArrays) return floors[index];
+        else return cells[index].floor;
+    }
+
+    [[nodiscard]] inline TileId ceiling(int index) const {
+        if constexpr (Layout == TileLayout::StructOfArrays) return ceilings[index];
+        else return cells[index].ceiling;
+    }
+
+    [[nodiscard]] inline TileCell<TileId> cell(int index) const {
+        if constexpr (Layout == TileLayout::StructOfArrays) return { walls[index], floors[index], ceilings[index], flags[index] };
+        else return cells[index];
+    }
+
+    [[nodiscard]] inline uint8_t getFlags(int index) const {
+        if constexpr (Layout == TileLayout::StructOfArrays) return flags[index];
+        else return cells[index].flags;
+    }
+
+    [[nodiscard]] inline bool isSolid(int index) const {
+        return getFlags(index) & TileFlags::SOLID;
+    }
+
+    [[nodiscard]] unsigned long long getVersion() const {
+        return version;
+    }
+
+    [[nodiscard]] TileLayerView<TileId> layer(TileLayer which) const {
+        if constexpr (Layout == TileLayout::StructOfArrays) {
+            const vector<TileId> &data = which == TileLayer::Wall ? walls : which == TileLayer::Floor ? floors : ceilings;
+            return { data.data(), sizeof(TileId), size(), &version };
+        } else {
+            if (size() == 0) return {};
+            const TileCell<TileId> &first = cells[0];
+            const TileId *id = which == TileLayer::Wall ? &first.wall : which == TileLayer::Floor ? &first.floor : &first.ceiling;
+            return { id, sizeof(TileCell<TileId>), size(), &version };
+        }
+    }
+
+    // Sets a tile without bumping the version. Each layer lives in its own fields, so different layers
+    // can be filled from different threads; call touch() once they are done.
+    void fill(TileLayer which, int index, int value) {
+        TileId id = toTileId(value);
+        if (which == TileLayer::Wall) {
+            uint8_t cellFlags = (getFlags(index) & ~TileFlags::SOLID) | (id > 0 ? TileFlags::SOLID : 0);
+            if constexpr (Layout == TileLayout::StructOfArrays) {
+                walls[index] = id;
+                flags[index] = cellFlags;
+            } else {
+                cells[index].wall = id;
+                cells[index].flags = cellFlags;
+            }
+        } else if (which == TileLayer::Floor) {
+            if constexpr (Layout == TileLayout::StructOfArrays) floors[index] = id;
+            else cells[index].floor = id;
+        } else {
+            if constexpr (Layout == TileLayout::StructOfArrays) ceilings[index] = id;
+            else cells[index].ceiling = id;
+        }
+    }
+
+    void touch() {
+        version++;
+    }
+
+    void setWall(int index, int value) {
+        fill(TileLayer::Wall, index, value);
+        version++;
+    }
+
+    void setFloor(int index, int value) {
+        fill(TileLayer::Floor, index, value);
+        version++;
+    }
+
+    void setCeiling(int index, int value) {
+        fill(TileLayer::Ceiling, index, value);
+        version++;
+    }
+
+    [[nodiscard]] size_t memoryFootprint() const {
+        if constexpr (Layout == TileLayout::StructOfArrays) {
+            return walls.capacity() * sizeof(TileId) + floors.capacity() * sizeof(TileId)
+                + ceilings.capacity() * sizeof(TileId) + flags.capacity() * sizeof(uint8_t);
+        } else {
+            return ownedCells.capacity() * sizeof(TileCell<TileId>);
+        }
+    }
+
+    [[nodiscard]] static constexpr const char *layoutName() {
+        return Layout == TileLayout::StructOfArrays ? "struct of arrays" : "interleaved";
+    }
+
+    [[nodiscard]] int getWidth() const {
+        return width;
+    }
+
+    [[nodiscard]] int getHeight() const {
+        return height;
+    }
+};
+
+#endif //RENEGADE_ENGINE_TILEGRID_H
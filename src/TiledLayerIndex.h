@@ -0,0 +1,246 @@
+#ifndef RENEGADE_ENGINE_TILEDLAYERINDEX_H
+#define RENEGADE_ENGINE_TILEDLAYERINDEX_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include "LayerCompression.h"
+
+using namespace std;
+
+// One pass over the text of a Tiled JSON map that finds the "data" arrays of its tile layers without
+// parsing them. Tileson gets the map with those arrays emptied, so it only builds its json objects for
+// the small parts (tilesets, objects, properties), and the gids are read straight from the text by
+// read(). Base64 layers are indexed as well and decoded by read(), chunks of infinite maps are left to
+// Tileson.
+class TiledLayerIndex {
+private:
+    struct Span {
+        size_t begin;
+        size_t end;
+        // base64 string instead of an array, with its compression
+        bool base64;
+        string compression;
+    };
+
+    string text;
+    // contents of the data array or string of every tile layer by layer name, without brackets or quotes
+    unordered_map<string, Span> layers;
+    size_t pos { 0 };
+
+    [[noreturn]] static void fail() {
+        throw runtime_error("Invalid map json");
+    }
+
+    void skipWhitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t')) pos++;
+    }
+
+    [[nodiscard]] char peek() {
+        skipWhitespace();
+        if (pos >= text.size()) fail();
+        return text[pos];
+    }
+
+    void expect(char c) {
+        if (peek() != c) fail();
+        pos++;
+    }
+
+    // Skips a string, pos is at the opening quote
+    void skipString() {
+        pos++;
+        while (pos < text.size() && text[pos] != '"') {
+            pos += text[pos] == '\\' ? 2 : 1;
+        }
+        if (pos >= text.size()) fail();
+        pos++;
+    }
+
+    // Names and keys, escapes other than \" and \\ are kept as they are
+    string readString() {
+        if (peek() != '"') fail();
+        size_t begin = ++pos;
+        string value;
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\' && pos + 1 < text.size() && (text[pos + 1] == '"' || text[pos + 1] == '\\')) {
+                value.append(text, begin, pos - begin);
+                begin = ++pos;
+            }
+            pos++;
+        }
+        if (pos >= text.size()) fail();
+        value.append(text, begin, pos - begin);
+        pos++;
+        return value;
+    }
+
+    void skipValue() {
+        char c = peek();
+        if (c == '"') {
+            skipString();
+            return;
+        }
+        if (c != '{' && c != '[') {
+            while (pos < text.size() && !strchr(",}] \n\r\t", text[pos])) pos++;
+            return;
+        }
+        int depth = 0;
+        while (pos < text.size()) {
+            c = text[pos];
+            if (c == '"') {
+                skipString();
+                continue;
+            }
+            if (c == '{' || c == '[') depth++;
+            else if (c == '}' || c == ']') depth--;
+            pos++;
+            if (depth == 0) return;
+        }
+        fail();
+    }
+
+    // Calls onKey(key) for every key of the object at pos, onKey has to consume the value
+    template<typename OnKey>
+    void readObject(OnKey onKey) {
+        expect('{');
+        if (peek() == '}') {
+            pos++;
+            return;
+        }
+        while (true) {
+            auto key = readString();
+            expect(':');
+            onKey(key);
+            if (peek() == ',') {
+                pos++;
+                continue;
+            }
+            expect('}');
+            return;
+        }
+    }
+
+    void readLayers() {
+        expect('[');
+        if (peek() == ']') {
+            pos++;
+            return;
+        }
+        while (true) {
+            if (peek() != '{') {
+                skipValue();
+            } else {
+                string name;
+                string encoding;
+                Span data { 0, 0, false, "" };
+                readObject([&](const string &key) {
+                    if (key == "name") {
+                        name = readString();
+                    } else if (key == "encoding" && peek() == '"') {
+                        encoding = readString();
+                    } else if (key == "compression" && peek() == '"') {
+                        data.compression = readString();
+                    } else if (key == "data" && peek() == '"') {
+                        data.begin = pos + 1;
+                        skipString();
+                        data.end = pos - 1;
+                        data.base64 = true;
+                    } else if (key == "data" && peek() == '[') {
+                        // tile ids never contain brackets
+                        data.begin = ++pos;
+                        auto end = (const char *)memchr(text.data() + pos, ']', text.size() - pos);
+                        if (end == nullptr) fail();
+                        data.end = end - text.data();
+                        pos = data.end + 1;
+                    } else if (key == "layers") {
+                        // group layer
+                        readLayers();
+                    } else {
+                        skipValue();
+                    }
+                });
+                if (data.base64 && encoding != "base64") data.end = data.begin;
+                if (data.end > data.begin && !layers.count(name)) layers[name] = data;
+            }
+            if (peek() == ',') {
+                pos++;
+                continue;
+            }
+            expect(']');
+            return;
+        }
+    }
+
+    // Little endian gids after decoding and decompressing, the output is sized for count of them
+    template<typename Setter>
+    size_t readBase64(const Span &span, size_t count, Setter set) const {
+        auto bytes = LayerCompression::decodeBase64(text.data() + span.begin, span.end - span.begin);
+        if (!span.compression.empty()) {
+            bytes = LayerCompression::decompress(span.compression, bytes.data(), bytes.size(), count * 4);
+        }
+        size_t gids = bytes.size() / 4;
+        const uint8_t *gid = bytes.data();
+        for (size_t i = 0; i < gids && i < count; i++, gid += 4) {
+            set((int)i, (uint32_t)gid[0] | (uint32_t)gid[1] << 8 | (uint32_t)gid[2] << 16 | (uint32_t)gid[3] << 24);
+        }
+        return gids;
+    }
+public:
+    explicit TiledLayerIndex(string json) : text(std::move(json)) {
+        readObject([this](const string &key) {
+            if (key == "layers") readLayers();
+            else skipValue();
+        });
+    }
+
+    [[nodiscard]] bool has(const string &layerName) const {
+        return layers.count(layerName) > 0;
+    }
+
+    // The map with the indexed data arrays blanked out, what Tileson gets to parse
+    [[nodiscard]] string stripped() const {
+        string result = text;
+        for (auto &layer : layers) {
+            auto &span = layer.second;
+            if (span.base64) {
+                // "" and the rest of the string as whitespace
+                result[span.begin] = '"';
+                memset(&result[span.begin + 1], ' ', span.end - span.begin);
+            } else {
+                memset(&result[span.begin], ' ', span.end - span.begin);
+            }
+        }
+        return result;
+    }
+
+    // Calls set(index, gid) for the gids of a layer, at most count of them. Returns how many there are.
+    template<typename Setter>
+    size_t read(const string &layerName, size_t count, Setter set) const {
+        auto layer = layers.find(layerName);
+        if (layer == layers.end()) return 0;
+        if (layer->second.base64) return readBase64(layer->second, count, set);
+        const char *c = text.data() + layer->second.begin;
+        const char *end = text.data() + layer->second.end;
+        size_t index = 0;
+        while (c < end) {
+            if (*c == ',' || *c == ' ' || *c == '\n' || *c == '\r' || *c == '\t') {
+                c++;
+                continue;
+            }
+            if (*c < '0' || *c > '9') throw runtime_error("Invalid " + layerName + " data");
+            uint64_t gid = 0;
+            while (c < end && *c >= '0' && *c <= '9') {
+                gid = gid * 10 + (*c++ - '0');
+                if (gid > UINT32_MAX) throw runtime_error("Invalid " + layerName + " data");
+            }
+            if (index < count) set((int)index, (uint32_t)gid);
+            index++;
+        }
+        return index;
+    }
+};
+
+#endif //RENEGADE_ENGINE_TILEDLAYERINDEX_H
@@ -0,0 +1,62 @@
+// Times CsvLevel on large generated layer exports and reports the parse throughput.
+// Not a ctest check, run csv-benchmark from a release build.
+#include "../src/CsvLevel.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace
+{
+    constexpr int ROUNDS = 5;
+
+    // Tiled's export, one row per line, -1 for empty tiles
+    size_t writeLayer(const std::string& path_, int width_, int height_, std::mt19937& random_)
+    {
+        std::string text;
+        for (int y = 0; y < height_; ++y) {
+            for (int x = 0; x < width_; ++x) {
+                int id = (int)(random_() % 300) - 1;
+                text += std::to_string(id);
+                text += x + 1 < width_ ? ',' : '\n';
+            }
+        }
+        std::ofstream(path_, std::ios::binary) << text;
+        return text.size();
+    }
+
+    void benchmark(int width_, int height_, std::mt19937& random_)
+    {
+        auto base = (std::filesystem::temp_directory_path() / "renegade-csv-benchmark").string();
+        size_t bytes = 0;
+        for (auto suffix : { "_walls.csv", "_floor.csv", "_ceiling.csv" }) {
+            bytes += writeLayer(base + suffix, width_, height_, random_);
+        }
+        std::vector<int> tiles((size_t)width_ * height_);
+        double best = 1e30;
+        for (int round = 0; round < ROUNDS; ++round) {
+            auto start = std::chrono::steady_clock::now();
+            CsvLevel level(base + "_walls.csv");
+            for (auto layer : { "walls", "floor", "ceiling" }) {
+                level.readLayerData(layer, [&](int i, int id) { tiles[i] = id; });
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        std::printf("%5d x %-5d  %7.1f MB  %8.2f ms  %7.1f MB/s\n", width_, height_, bytes / 1e6, best * 1e3,
+            bytes / 1e6 / best);
+        for (auto suffix : { "_walls.csv", "_floor.csv", "_ceiling.csv" }) {
+            std::filesystem::remove(base + suffix);
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 random(1);
+    benchmark(256, 256, random);
+    benchmark(1024, 1024, random);
+    benchmark(4096, 4096, random);
+    return 0;
+}
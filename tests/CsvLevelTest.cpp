@@ -0,0 +1,80 @@
+// Checks the size, tiles and objects CsvLevel reads from layer exports, exits with 1 on the first failure
+#include "../src/CsvLevel.h"
+#include "TestWorld.h"
+#include <filesystem>
+#include <fstream>
+
+using namespace TestWorld;
+
+namespace
+{
+    std::string writeLevel(const std::string& name_, const std::string& walls_)
+    {
+        auto base = (std::filesystem::temp_directory_path() / ("renegade-csv-test-" + name_)).string();
+        for (auto suffix : { "_walls.csv", "_floor.csv", "_ceiling.csv" }) {
+            std::ofstream(base + suffix, std::ios::binary) << walls_;
+        }
+        return base + "_walls.csv";
+    }
+
+    void removeLevel(const std::string& path_)
+    {
+        auto base = path_.substr(0, path_.size() - strlen("_walls.csv"));
+        for (auto suffix : { "_walls.csv", "_floor.csv", "_ceiling.csv" }) {
+            std::filesystem::remove(base + suffix);
+        }
+    }
+
+    void expectLevel(const std::string& name_, const std::string& walls_)
+    {
+        auto path = writeLevel(name_, walls_);
+        try {
+            CsvLevel level(path);
+            auto size = level.getSize();
+            check(size.x == 3 && size.y == 2, name_ + ": size is " + std::to_string(size.x) + "x" + std::to_string(size.y));
+            auto data = level.getLayerData("walls");
+            check(data == std::vector<int>({ 1, 2, 3, -1, 5, 6 }), name_ + ": tiles differ");
+        } catch (std::exception& e) {
+            check(false, name_ + ": " + e.what());
+        }
+        removeLevel(path);
+    }
+
+    // Objects come from the Tiled map next to the layers, a level without one has none
+    void objects()
+    {
+        auto path = writeLevel("objects", "1,2,3\n-1,5,6\n");
+        auto mapPath = path.substr(0, path.size() - strlen("_walls.csv")) + ".json";
+        try {
+            check(CsvLevel(path).getObjects().empty(), "objects without a map");
+            std::ofstream(mapPath, std::ios::binary) << "{\"width\":3,\"height\":2,\"tilewidth\":32,\"tileheight\":32,"
+                "\"infinite\":false,\"orientation\":\"orthogonal\",\"renderorder\":\"right-down\",\"type\":\"map\","
+                "\"version\":\"1.10\",\"tiledversion\":\"1.10.2\",\"nextlayerid\":2,\"nextobjectid\":2,\"tilesets\":[],"
+                "\"layers\":[{\"id\":1,\"name\":\"objects\",\"type\":\"objectgroup\",\"visible\":true,\"opacity\":1,"
+                "\"x\":0,\"y\":0,\"draworder\":\"topdown\",\"objects\":[{\"id\":1,\"name\":\"next.json\",\"type\":\"exit\","
+                "\"x\":48,\"y\":16,\"width\":0,\"height\":0,\"rotation\":0,\"visible\":true}]}]}";
+            CsvLevel level(path);
+            auto found = level.getObjects();
+            check(found.size() == 1 && found[0].type == "exit" && found[0].name == "next.json"
+                && found[0].position.x == 48 && found[0].position.y == 16, "objects of the map next to the layers");
+            auto inputs = level.getInputPaths();
+            check(std::find(inputs.begin(), inputs.end(), mapPath) != inputs.end(), "map is no input of the level");
+        } catch (std::exception& e) {
+            check(false, std::string("objects: ") + e.what());
+        }
+        std::filesystem::remove(mapPath);
+        removeLevel(path);
+    }
+}
+
+int main()
+{
+    expectLevel("plain", "1,2,3\n-1,5,6\n");
+    expectLevel("no trailing newline", "1,2,3\n-1,5,6");
+    expectLevel("trailing blank line", "1,2,3\n-1,5,6\n\n");
+    expectLevel("windows line ends", "1,2,3\r\n-1,5,6\r\n");
+    expectLevel("windows blank line", "1,2,3\r\n-1,5,6\r\n\r\n");
+    expectLevel("leading blank line", "\n1,2,3\n-1,5,6\n");
+    objects();
+    return result();
+}
@@ -0,0 +1,147 @@
+// Checks the costs and steps of FlowField against A*, exits with 1 on the first failure
+#include "../src/FlowField.h"
+#include "../lib/AStar/AStar.hpp"
+#include "TestWorld.h"
+
+using namespace TestWorld;
+
+namespace
+{
+    struct Field
+    {
+        World world;
+        SolidGrid solid;
+        FlowField field;
+        AStar::Generator aStar;
+
+        Field(World world_, int range_)
+            : world(std::move(world_)), solid(world.size.x, world.size.y), field(solid, range_)
+        {
+            for (int y = 0; y < world.size.y; ++y) {
+                for (int x = 0; x < world.size.x; ++x) {
+                    solid.set(x, y, world.isBlocked({ x, y }));
+                }
+            }
+            aStar.setWorldSize(world.size);
+            aStar.setDiagonalMovement(true);
+            aStar.setHeuristic(AStar::Heuristic::octagonal);
+            aStar.setCollisionGrid({ solid.data(), solid.getRowWords() });
+        }
+
+        void toggleWall(AStar::Vec2i tile_)
+        {
+            world.setBlocked(tile_.x, tile_.y, !world.isBlocked(tile_));
+            solid.set(tile_.x, tile_.y, world.isBlocked(tile_));
+        }
+
+        // Walks the steps from a tile, true if they reach the target with the field's cost
+        bool follow(AStar::Vec2i from_, AStar::Vec2i target_)
+        {
+            AStar::CoordinateList path = { from_ };
+            AStar::Vec2i tile = from_;
+            int x, y;
+            while (field.next(tile.x, tile.y, x, y)) {
+                tile = { x, y };
+                path.push_back(tile);
+                if (path.size() > (size_t)world.size.x * world.size.y) {
+                    return false;
+                }
+            }
+            std::reverse(path.begin(), path.end());
+            return isPath(world, path, from_, target_) && pathCost(path) == field.cost(from_.x, from_.y);
+        }
+
+        // With a range covering the world every cost is A*'s, with a smaller one paths may only be
+        // longer because they stay in the window
+        void compare(AStar::Vec2i target_, bool covered_, const std::string& name_)
+        {
+            for (int y = 0; y < world.size.y; ++y) {
+                for (int x = 0; x < world.size.x; ++x) {
+                    std::string what = name_ + " from " + std::to_string(x) + ", " + std::to_string(y);
+                    uint32_t cost = field.cost(x, y);
+                    if (world.isBlocked({ x, y }) || world.isBlocked(target_)) {
+                        check(cost == FlowField::UNREACHED, what + ": wall or walled target has a cost");
+                        continue;
+                    }
+                    auto path = aStar.findPath({ x, y }, target_);
+                    bool reachable = AStar::Vec2i(path.front()) == target_;
+                    if (!reachable) {
+                        check(cost == FlowField::UNREACHED, what + ": unreachable tile has a cost");
+                        continue;
+                    }
+                    if (covered_) {
+                        check(cost == pathCost(path), what + ": cost " + std::to_string(cost) + ", A* "
+                            + std::to_string(pathCost(path)));
+                    }
+                    else {
+                        check(cost == FlowField::UNREACHED || cost >= pathCost(path), what + ": cost below A*'s");
+                    }
+                    if (cost != FlowField::UNREACHED && !(AStar::Vec2i{ x, y } == target_)) {
+                        check(follow({ x, y }, target_), what + ": steps do not lead to the target at its cost");
+                    }
+                }
+            }
+        }
+    };
+
+    void wholeWorld()
+    {
+        std::mt19937 random(53);
+        for (int round = 0; round < 8; ++round) {
+            Field field(noise(30 + round * 4, 20 + round * 3, 10 + round * 4, random), 1000);
+            std::string name = "world " + std::to_string(round);
+            for (int move = 0; move < 4; ++move) {
+                AStar::Vec2i target = field.world.randomFreeTile(random);
+                field.solid.set(target.x, target.y, false);
+                check(field.field.setTarget(target.x, target.y), name + ": moved target not recalculated");
+                field.compare(target, true, name + " target " + std::to_string(move));
+            }
+        }
+    }
+
+    // A window smaller than the world, moving with the target
+    void window()
+    {
+        std::mt19937 random(59);
+        Field field(noise(80, 60, 15, random), 12);
+        for (int move = 0; move < 6; ++move) {
+            AStar::Vec2i target = field.world.randomFreeTile(random);
+            field.solid.set(target.x, target.y, false);
+            field.field.setTarget(target.x, target.y);
+            field.compare(target, false, "window target " + std::to_string(move));
+            check(field.field.cost(target.x + 13, target.y) == FlowField::UNREACHED, "tile outside the window has a cost");
+        }
+    }
+
+    // Walls that change under a target that stays put
+    void changedWalls()
+    {
+        std::mt19937 random(61);
+        Field field(noise(40, 30, 20, random), 1000);
+        AStar::Vec2i target = field.world.randomFreeTile(random);
+        field.solid.set(target.x, target.y, false);
+        field.field.setTarget(target.x, target.y);
+        check(!field.field.setTarget(target.x, target.y), "unchanged field recalculated");
+        for (int round = 0; round < 5; ++round) {
+            for (int i = 0; i < 30; ++i) {
+                AStar::Vec2i tile = { (int)(random() % 40), (int)(random() % 30) };
+                if (!(tile == target)) {
+                    field.toggleWall(tile);
+                }
+            }
+            check(field.field.setTarget(target.x, target.y), "field not recalculated after the walls changed");
+            field.compare(target, true, "changed walls " + std::to_string(round));
+        }
+        field.toggleWall(target);
+        field.field.setTarget(target.x, target.y);
+        field.compare(target, true, "target in a wall");
+    }
+}
+
+int main()
+{
+    wholeWorld();
+    window();
+    changedWalls();
+    return result();
+}
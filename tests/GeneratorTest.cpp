@@ -0,0 +1,188 @@
+// Checks AStar::Generator and its collision grids against a plain Dijkstra search, exits with 1 on the first failure
+#include "../lib/AStar/AStar.hpp"
+#include "TestWorld.h"
+#include <queue>
+
+using namespace TestWorld;
+
+namespace
+{
+    const AStar::uint UNREACHED = ~0u;
+
+    // Cost of the cheapest path from the source to every tile, with the generator's movement rules:
+    // a step only needs its destination to be free
+    std::vector<AStar::uint> dijkstra(const World& world_, AStar::Vec2i source_, bool diagonal_)
+    {
+        const int moveX[8] = { 0, 1, 0, -1, -1, 1, -1, 1 };
+        const int moveY[8] = { 1, 0, -1, 0, -1, 1, 1, -1 };
+        std::vector<AStar::uint> costs((size_t)world_.size.x * world_.size.y, UNREACHED);
+        using Entry = std::pair<AStar::uint, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        costs[source_.y * world_.size.x + source_.x] = 0;
+        open.push({ 0, source_.y * world_.size.x + source_.x });
+        while (!open.empty()) {
+            auto current = open.top();
+            open.pop();
+            if (current.first != costs[current.second]) {
+                continue;
+            }
+            int x = current.second % world_.size.x;
+            int y = current.second / world_.size.x;
+            for (int i = 0; i < (diagonal_ ? 8 : 4); ++i) {
+                AStar::Vec2i next = { x + moveX[i], y + moveY[i] };
+                if (world_.isBlocked(next)) {
+                    continue;
+                }
+                AStar::uint cost = current.first + (i < 4 ? 10 : 14);
+                int tile = next.y * world_.size.x + next.x;
+                if (cost < costs[tile]) {
+                    costs[tile] = cost;
+                    open.push({ cost, tile });
+                }
+            }
+        }
+        return costs;
+    }
+
+    // The cost of the path when the target is reachable, otherwise that it leads to the reachable tile
+    // closest to the target by the heuristic
+    void compare(AStar::Generator& generator_, const World& world_, AStar::Vec2i source_, AStar::Vec2i target_,
+        bool diagonal_, AStar::HeuristicFunction heuristic_, const std::string& name_)
+    {
+        auto costs = dijkstra(world_, source_, diagonal_);
+        auto path = generator_.findPath(source_, target_);
+        AStar::uint expected = costs[target_.y * world_.size.x + target_.x];
+        AStar::Vec2i end = path.front();
+        bool walkable = isPath(world_, path, source_, end);
+        for (size_t i = 1; walkable && !diagonal_ && i < path.size(); ++i) {
+            walkable = std::abs(path[i].x - path[i - 1].x) + std::abs(path[i].y - path[i - 1].y) == 1;
+        }
+        check(walkable, name_ + ": path is not walkable");
+        if (expected != UNREACHED) {
+            check(end == target_, name_ + ": reachable target not reached");
+            check(pathCost(path) == expected, name_ + ": path costs " + std::to_string(pathCost(path))
+                + ", Dijkstra " + std::to_string(expected));
+            return;
+        }
+        check(!(end == target_), name_ + ": unreachable target reached");
+        AStar::uint closest = UNREACHED;
+        for (int tile = 0; tile < (int)costs.size(); ++tile) {
+            if (costs[tile] != UNREACHED) {
+                closest = std::min(closest, heuristic_({ tile % world_.size.x, tile / world_.size.x }, target_));
+            }
+        }
+        check(heuristic_(end, target_) == closest, name_ + ": path does not end at the closest reachable tile");
+    }
+
+    // One generator for every query and world, so the search state is reused and resized
+    void randomWorlds(bool diagonal_)
+    {
+        std::mt19937 random(diagonal_ ? 41 : 43);
+        AStar::HeuristicFunction heuristic = diagonal_ ? AStar::Heuristic::octagonal : AStar::Heuristic::manhattan;
+        AStar::Generator generator;
+        generator.setDiagonalMovement(diagonal_);
+        generator.setHeuristic(heuristic);
+        for (int round = 0; round < 20; ++round) {
+            World world = noise(20 + round * 9 % 70, 15 + round * 7 % 50, 15 + round * 3 % 30, random);
+            generator.setWorldSize(world.size);
+            generator.setCollisionGrid(world.grid());
+            for (int query = 0; query < 30; ++query) {
+                AStar::Vec2i source = world.randomFreeTile(random);
+                AStar::Vec2i target = world.randomFreeTile(random);
+                compare(generator, world, source, target, diagonal_, heuristic,
+                    std::string(diagonal_ ? "8" : "4") + " connected world " + std::to_string(round)
+                    + " query " + std::to_string(query));
+            }
+        }
+    }
+
+    // Tiles blocked in either grid
+    World merge(const World& referenced_, const World& own_)
+    {
+        World world(own_.size.x, own_.size.y);
+        for (int y = 0; y < world.size.y; ++y) {
+            for (int x = 0; x < world.size.x; ++x) {
+                world.setBlocked(x, y, referenced_.isBlocked({ x, y }) || own_.isBlocked({ x, y }));
+            }
+        }
+        return world;
+    }
+
+    void queries(AStar::Generator& generator_, const World& world_, std::mt19937& random_, const std::string& name_)
+    {
+        for (int query = 0; query < 30; ++query) {
+            AStar::Vec2i source = { (int)(random_() % world_.size.x), (int)(random_() % world_.size.y) };
+            AStar::Vec2i target = { (int)(random_() % world_.size.x), (int)(random_() % world_.size.y) };
+            if (world_.isBlocked(source)) {
+                continue;
+            }
+            compare(generator_, world_, source, target, true, AStar::Heuristic::octagonal,
+                name_ + " query " + std::to_string(query));
+        }
+    }
+
+    // The generator's own collisions on top of a referenced grid with wider rows than the world
+    void ownAndReferencedCollisions()
+    {
+        std::mt19937 random(47);
+        World referenced = noise(150, 50, 15, random);
+        World own = noise(70, 50, 15, random);
+        AStar::Generator generator;
+        generator.setDiagonalMovement(true);
+        generator.setHeuristic(AStar::Heuristic::octagonal);
+        generator.setWorldSize(own.size);
+        generator.setCollisionGrid(referenced.grid());
+        for (int y = 0; y < own.size.y; ++y) {
+            for (int x = 0; x < own.size.x; ++x) {
+                if (own.isBlocked({ x, y })) {
+                    generator.addCollision({ x, y });
+                }
+            }
+        }
+        // ignored, outside the world
+        generator.addCollision({ -1, 3 });
+        generator.addCollision({ own.size.x, 3 });
+        generator.addCollision({ 3, own.size.y });
+        queries(generator, merge(referenced, own), random, "both grids");
+
+        // the referenced grid is read by every query
+        for (int i = 0; i < 200; ++i) {
+            int x = (int)(random() % own.size.x);
+            int y = (int)(random() % own.size.y);
+            referenced.setBlocked(x, y, !referenced.isBlocked({ x, y }));
+        }
+        queries(generator, merge(referenced, own), random, "changed referenced grid");
+
+        for (int i = 0; i < 200; ++i) {
+            AStar::Vec2i tile = { (int)(random() % own.size.x), (int)(random() % own.size.y) };
+            own.setBlocked(tile.x, tile.y, false);
+            generator.removeCollision(tile);
+        }
+        queries(generator, merge(referenced, own), random, "removed own collisions");
+
+        generator.clearCollisions();
+        queries(generator, merge(referenced, World(own.size.x, own.size.y)), random, "cleared own collisions");
+
+        // a wall layer replaces the own collisions
+        World layerWorld = noise(70, 50, 20, random);
+        std::vector<int> layer((size_t)own.size.x * own.size.y);
+        for (size_t i = 0; i < layer.size(); ++i) {
+            layer[i] = layerWorld.isBlocked({ (int)(i % own.size.x), (int)(i / own.size.x) }) ? 1 + (int)(random() % 5) : (int)(random() % 2) - 1;
+        }
+        generator.addCollision({ 1, 1 });
+        layerWorld.setBlocked(1, 1, layer[own.size.x + 1] > 0);
+        generator.setCollisions(layer);
+        queries(generator, merge(referenced, layerWorld), random, "wall layer");
+
+        generator.setCollisionGrid({});
+        queries(generator, layerWorld, random, "own collisions only");
+    }
+}
+
+int main()
+{
+    randomWorlds(false);
+    randomWorlds(true);
+    ownAndReferencedCollisions();
+    return result();
+}
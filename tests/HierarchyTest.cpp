@@ -0,0 +1,84 @@
+// Checks that HPA* reaches the same tiles as A*, exits with 1 on the first failure
+#include "../lib/AStar/AStar.hpp"
+#include "../lib/AStar/Hierarchy.hpp"
+#include "TestWorld.h"
+
+using namespace TestWorld;
+
+namespace
+{
+    void compare(const World& world_, AStar::Vec2i source_, AStar::Vec2i target_, const std::string& name_)
+    {
+        AStar::Generator generator;
+        generator.setWorldSize(world_.size);
+        generator.setDiagonalMovement(true);
+        generator.setCollisionGrid(world_.grid());
+        AStar::Hierarchy hierarchy;
+        hierarchy.setWorldSize(world_.size);
+        hierarchy.setCollisionGrid(world_.grid());
+
+        bool reachable = AStar::Vec2i(generator.findPath(source_, target_).front()) == target_;
+        auto path = hierarchy.findPath(source_, target_);
+        bool reached = AStar::Vec2i(path.front()) == target_;
+        check(reachable == reached, name_ + ": A* and HPA* disagree on reachability");
+        if (reached) {
+            check(isPath(world_, path, source_, target_), name_ + ": HPA* path is not walkable");
+        }
+    }
+
+    // Clusters of 16 joined only by one diagonal step across the border between x 15 and 16
+    void diagonalBorder()
+    {
+        World world(32, 16);
+        for (int y = 0; y < 16; ++y) {
+            world.setBlocked(15, y, y != 5);
+            world.setBlocked(16, y, y != 6);
+        }
+        compare(world, { 2, 2 }, { 30, 12 }, "diagonal step across a border");
+        compare(world, { 30, 12 }, { 2, 2 }, "diagonal step across a border, backwards");
+    }
+
+    // Clusters of 16 joined only by one diagonal step across the corner at (15, 15) and (16, 16)
+    void diagonalCorner()
+    {
+        World world(32, 32);
+        for (int i = 0; i < 32; ++i) {
+            world.setBlocked(15, i, i != 15);
+            world.setBlocked(16, i, i != 16);
+            world.setBlocked(i, 15, i != 15);
+            world.setBlocked(i, 16, i != 16);
+        }
+        compare(world, { 2, 2 }, { 30, 30 }, "diagonal step across a corner");
+        compare(world, { 30, 30 }, { 2, 2 }, "diagonal step across a corner, backwards");
+        compare(world, { 2, 2 }, { 30, 2 }, "corner step leads nowhere else");
+    }
+
+    void randomWorlds()
+    {
+        std::mt19937 random(5);
+        for (int round = 0; round < 40; ++round) {
+            World world(48 + round % 5, 40 + round % 7);
+            int density = 25 + round % 20;
+            for (int y = 0; y < world.size.y; ++y) {
+                for (int x = 0; x < world.size.x; ++x) {
+                    world.setBlocked(x, y, (int)(random() % 100) < density);
+                }
+            }
+            for (int query = 0; query < 20; ++query) {
+                AStar::Vec2i source = { (int)(random() % world.size.x), (int)(random() % world.size.y) };
+                AStar::Vec2i target = { (int)(random() % world.size.x), (int)(random() % world.size.y) };
+                world.setBlocked(source.x, source.y, false);
+                world.setBlocked(target.x, target.y, false);
+                compare(world, source, target, "random world " + std::to_string(round) + " query " + std::to_string(query));
+            }
+        }
+    }
+}
+
+int main()
+{
+    diagonalBorder();
+    diagonalCorner();
+    randomWorlds();
+    return result();
+}
@@ -0,0 +1,107 @@
+// Checks that Jump Point Search finds paths of the same cost as A*, exits with 1 on the first failure
+#include "../lib/AStar/AStar.hpp"
+#include "TestWorld.h"
+
+using namespace TestWorld;
+
+namespace
+{
+    void setup(AStar::Generator& generator_, const World& world_, bool jumpPointSearch_)
+    {
+        generator_.setWorldSize(world_.size);
+        generator_.setDiagonalMovement(true);
+        generator_.setHeuristic(AStar::Heuristic::octagonal);
+        generator_.setJumpPointSearch(jumpPointSearch_);
+    }
+
+    void compare(AStar::Generator& aStar_, AStar::Generator& jps_, const World& world_,
+        AStar::Vec2i source_, AStar::Vec2i target_, const std::string& name_)
+    {
+        auto expected = aStar_.findPath(source_, target_);
+        auto path = jps_.findPath(source_, target_);
+        bool reachable = AStar::Vec2i(expected.front()) == target_;
+        bool reached = AStar::Vec2i(path.front()) == target_;
+        check(reachable == reached, name_ + ": A* and JPS disagree on reachability");
+        if (!reachable || !reached) {
+            return;
+        }
+        check(isPath(world_, path, source_, target_), name_ + ": JPS path is not walkable");
+        check(pathCost(path) == pathCost(expected), name_ + ": JPS path costs " + std::to_string(pathCost(path))
+            + ", A* " + std::to_string(pathCost(expected)));
+    }
+
+    void queries(const World& world_, int count_, std::mt19937& random_, const std::string& name_)
+    {
+        World world = world_;
+        AStar::Generator aStar, jps;
+        setup(aStar, world, false);
+        setup(jps, world, true);
+        aStar.setCollisionGrid(world.grid());
+        jps.setCollisionGrid(world.grid());
+        for (int query = 0; query < count_; ++query) {
+            AStar::Vec2i source = world.randomFreeTile(random_);
+            AStar::Vec2i target = world.randomFreeTile(random_);
+            compare(aStar, jps, world, source, target, name_ + " query " + std::to_string(query));
+        }
+    }
+
+    // Widths that are not a multiple of 64 and crossing the word boundaries of the jump grids
+    void noiseWorlds()
+    {
+        std::mt19937 random(3);
+        for (int round = 0; round < 30; ++round) {
+            int density = 10 + round % 26;
+            World world = noise(40 + round * 7, 30 + round * 3, density, random);
+            queries(world, 40, random, "noise " + std::to_string(round));
+        }
+    }
+
+    void mazes()
+    {
+        std::mt19937 random(9);
+        for (int size : { 31, 65, 129 }) {
+            queries(maze(size, size, random), 40, random, "maze " + std::to_string(size));
+        }
+    }
+
+    void openWorld()
+    {
+        std::mt19937 random(13);
+        queries(World(200, 150), 40, random, "open world");
+    }
+
+    // Walls of the generator's own grid instead of a referenced one
+    void ownCollisions()
+    {
+        std::mt19937 random(17);
+        World world = noise(97, 61, 25, random);
+        AStar::Generator aStar, jps;
+        setup(aStar, world, false);
+        setup(jps, world, true);
+        for (int y = 0; y < world.size.y; ++y) {
+            for (int x = 0; x < world.size.x; ++x) {
+                if (world.isBlocked({ x, y })) {
+                    aStar.addCollision({ x, y });
+                    jps.addCollision({ x, y });
+                }
+            }
+        }
+        for (int query = 0; query < 60; ++query) {
+            AStar::Vec2i source = { (int)(random() % world.size.x), (int)(random() % world.size.y) };
+            AStar::Vec2i target = { (int)(random() % world.size.x), (int)(random() % world.size.y) };
+            if (world.isBlocked(source) || world.isBlocked(target)) {
+                continue;
+            }
+            compare(aStar, jps, world, source, target, "own collisions query " + std::to_string(query));
+        }
+    }
+}
+
+int main()
+{
+    noiseWorlds();
+    mazes();
+    openWorld();
+    ownCollisions();
+    return result();
+}
@@ -0,0 +1,58 @@
+// Times loading a level with its tile layers in every encoding this build supports, against the plain
+// CSV array. Not a ctest check, run layer-compression-benchmark from a release build.
+#include "../src/Level.h"
+#include "LayerEncoding.h"
+#include <chrono>
+#include <filesystem>
+#include <random>
+
+namespace
+{
+    constexpr int ROUNDS = 10;
+
+    // Level-like layers: scattered walls, a floor of a few tiles and a mostly closed ceiling
+    std::vector<std::pair<std::string, std::vector<uint32_t>>> layers(int width_, int height_, std::mt19937& random_)
+    {
+        size_t count = (size_t)width_ * height_;
+        std::vector<uint32_t> walls(count), floor(count), ceiling(count);
+        for (size_t i = 0; i < count; ++i) {
+            walls[i] = random_() % 100 < 20 ? 1 + random_() % 8 : 0;
+            floor[i] = 20 + random_() % 4;
+            ceiling[i] = random_() % 100 < 90 ? 30 : 0;
+        }
+        return { { "walls", walls }, { "floor", floor }, { "ceiling", ceiling } };
+    }
+
+    void benchmark(int width_, int height_, std::mt19937& random_)
+    {
+        auto tiles = layers(width_, height_, random_);
+        std::vector<int> data((size_t)width_ * height_);
+        std::printf("%d x %d, 3 layers\n", width_, height_);
+        for (auto& encoding : LayerEncoding::encodings()) {
+            auto path = (std::filesystem::temp_directory_path() / ("renegade-layer-benchmark-" + encoding + ".json")).string();
+            auto text = LayerEncoding::map(encoding, width_, height_, tiles);
+            LayerEncoding::write(path, text);
+            double best = 1e30;
+            for (int round = 0; round < ROUNDS; ++round) {
+                auto start = std::chrono::steady_clock::now();
+                Level level(path);
+                for (auto name : { "walls", "floor", "ceiling" }) {
+                    level.readLayerData(name, [&](int i, int id) { data[i] = id; });
+                }
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                best = std::min(best, elapsed.count());
+            }
+            std::printf("  %-7s %10.1f KB  %8.2f ms\n", encoding.c_str(), text.size() / 1024.0, best);
+            std::filesystem::remove(path);
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 random(1);
+    benchmark(64, 64, random);
+    benchmark(256, 256, random);
+    benchmark(1024, 1024, random);
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Checks that every layer encoding this build supports loads the same tiles as the plain CSV array,
+// exits with 1 on the first failure
+#include "../src/Level.h"
+#include "LayerEncoding.h"
+#include "TestWorld.h"
+#include <filesystem>
+
+using namespace TestWorld;
+
+namespace
+{
+    const char* LAYERS[] = { "walls", "floor", "ceiling" };
+
+    std::vector<std::vector<int>> load(const std::string& path_)
+    {
+        Level level(path_);
+        std::vector<std::vector<int>> layers;
+        for (auto name : LAYERS) {
+            layers.push_back(level.getLayerData(name));
+        }
+        return layers;
+    }
+
+    // Widths that leave a partial base64 group at the end
+    void roundTrip(int width_, int height_, std::mt19937& random_)
+    {
+        std::vector<std::pair<std::string, std::vector<uint32_t>>> layers;
+        for (auto name : LAYERS) {
+            std::vector<uint32_t> gids((size_t)width_ * height_);
+            for (auto& gid : gids) {
+                // empty tiles, large ids and a flip flag that loading drops
+                gid = random_() % 4 == 0 ? 0 : (uint32_t)(random_() % 70000) | (random_() % 8 == 0 ? 0x80000000u : 0);
+            }
+            layers.emplace_back(name, gids);
+        }
+        std::string size = std::to_string(width_) + "x" + std::to_string(height_);
+        auto directory = std::filesystem::temp_directory_path();
+        auto plainPath = (directory / "renegade-layer-test-csv.json").string();
+        LayerEncoding::write(plainPath, LayerEncoding::map("csv", width_, height_, layers));
+        auto expected = load(plainPath);
+        std::filesystem::remove(plainPath);
+        for (size_t i = 0; i < 3; ++i) {
+            bool same = expected[i].size() == layers[i].second.size();
+            for (size_t tile = 0; same && tile < expected[i].size(); ++tile) {
+                same = expected[i][tile] == (int)(layers[i].second[tile] & 0x1FFFFFFF) - 1;
+            }
+            check(same, size + " csv: " + LAYERS[i] + " differs from the written gids");
+        }
+        for (auto& encoding : LayerEncoding::encodings()) {
+            if (encoding == "csv") continue;
+            auto path = (directory / ("renegade-layer-test-" + encoding + ".json")).string();
+            LayerEncoding::write(path, LayerEncoding::map(encoding, width_, height_, layers));
+            try {
+                auto loaded = load(path);
+                for (size_t i = 0; i < 3; ++i) {
+                    check(loaded[i] == expected[i], size + " " + encoding + ": " + LAYERS[i] + " differs from csv");
+                }
+            } catch (std::exception& e) {
+                check(false, size + " " + encoding + ": " + e.what());
+            }
+            std::filesystem::remove(path);
+        }
+    }
+
+#ifdef RENEGADE_ZSTD
+    // zstd straight through LayerCompression: output larger than expected, and cut off frames
+    void zstd(std::mt19937& random_)
+    {
+        check(LayerCompression::isSupported("zstd"), "zstd build does not decode zstd");
+        std::vector<uint8_t> bytes(1 << 20);
+        for (auto& byte : bytes) {
+            byte = random_() % 4 == 0 ? (uint8_t)random_() : 0;
+        }
+        auto compressed = LayerEncoding::compress("zstd", bytes);
+        try {
+            auto decompressed = LayerCompression::decompress("zstd", compressed.data(), compressed.size());
+            check(decompressed == bytes, "zstd: round trip differs");
+            decompressed = LayerCompression::decompress("zstd", compressed.data(), compressed.size(), bytes.size());
+            check(decompressed == bytes, "zstd: round trip with the expected size differs");
+        } catch (std::exception& e) {
+            check(false, std::string("zstd: ") + e.what());
+        }
+        bool thrown = false;
+        try {
+            LayerCompression::decompress("zstd", compressed.data(), compressed.size() / 2, bytes.size());
+        } catch (std::runtime_error&) {
+            thrown = true;
+        }
+        check(thrown, "zstd: truncated frame was accepted");
+    }
+#endif
+}
+
+int main()
+{
+    std::mt19937 random(21);
+    std::string supported;
+    for (auto& encoding : LayerEncoding::encodings()) {
+        supported += " " + encoding;
+    }
+    std::printf("encodings:%s\n", supported.c_str());
+    roundTrip(16, 16, random);
+    roundTrip(37, 11, random);
+    roundTrip(1, 1, random);
+    roundTrip(200, 150, random);
+#ifdef RENEGADE_ZSTD
+    zstd(random);
+#endif
+    return result();
+}
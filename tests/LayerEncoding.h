@@ -0,0 +1,135 @@
+// Writes Tiled JSON maps with their tile layers in each of the encodings LayerCompression reads, for
+// the layer checks and benchmarks
+#ifndef RENEGADE_ENGINE_LAYERENCODING_H
+#define RENEGADE_ENGINE_LAYERENCODING_H
+
+#include "../src/LayerCompression.h"
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace LayerEncoding
+{
+    // Base64 plus every compression this build can decode, "csv" is the plain array
+    inline std::vector<std::string> encodings()
+    {
+        std::vector<std::string> result = { "csv", "base64" };
+        for (auto compression : { "zlib", "gzip", "zstd", "lzma" }) {
+            if (LayerCompression::isSupported(compression)) {
+                result.emplace_back(compression);
+            }
+        }
+        return result;
+    }
+
+    inline std::string encodeBase64(const std::vector<uint8_t>& bytes_)
+    {
+        const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string text;
+        text.reserve((bytes_.size() + 2) / 3 * 4);
+        for (size_t i = 0; i < bytes_.size(); i += 3) {
+            uint32_t bits = (uint32_t)bytes_[i] << 16;
+            if (i + 1 < bytes_.size()) bits |= (uint32_t)bytes_[i + 1] << 8;
+            if (i + 2 < bytes_.size()) bits |= bytes_[i + 2];
+            text += alphabet[(bits >> 18) & 63];
+            text += alphabet[(bits >> 12) & 63];
+            text += i + 1 < bytes_.size() ? alphabet[(bits >> 6) & 63] : '=';
+            text += i + 2 < bytes_.size() ? alphabet[bits & 63] : '=';
+        }
+        return text;
+    }
+
+    inline std::vector<uint8_t> compress(const std::string& compression_, const std::vector<uint8_t>& bytes_)
+    {
+        if (compression_ == "base64") return bytes_;
+#ifdef RENEGADE_ZLIB
+        if (compression_ == "zlib" || compression_ == "gzip") {
+            z_stream stream {};
+            // 15 + 16 writes a gzip header instead of a zlib one
+            int windowBits = compression_ == "gzip" ? 15 + 16 : 15;
+            deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY);
+            std::vector<uint8_t> out(deflateBound(&stream, (uLong)bytes_.size()));
+            stream.next_in = (Bytef*)bytes_.data();
+            stream.avail_in = (uInt)bytes_.size();
+            stream.next_out = out.data();
+            stream.avail_out = (uInt)out.size();
+            int result = deflate(&stream, Z_FINISH);
+            out.resize(stream.total_out);
+            deflateEnd(&stream);
+            if (result != Z_STREAM_END) throw std::runtime_error("Could not compress with " + compression_);
+            return out;
+        }
+#endif
+#ifdef RENEGADE_ZSTD
+        if (compression_ == "zstd") {
+            std::vector<uint8_t> out(ZSTD_compressBound(bytes_.size()));
+            size_t size = ZSTD_compress(out.data(), out.size(), bytes_.data(), bytes_.size(), 3);
+            if (ZSTD_isError(size)) throw std::runtime_error("Could not compress with zstd");
+            out.resize(size);
+            return out;
+        }
+#endif
+#ifdef RENEGADE_LZMA
+        if (compression_ == "lzma") {
+            std::vector<uint8_t> out(lzma_stream_buffer_bound(bytes_.size()));
+            size_t size = 0;
+            if (lzma_easy_buffer_encode(6, LZMA_CHECK_CRC32, nullptr, bytes_.data(), bytes_.size(),
+                    out.data(), &size, out.size()) != LZMA_OK) {
+                throw std::runtime_error("Could not compress with lzma");
+            }
+            out.resize(size);
+            return out;
+        }
+#endif
+        throw std::runtime_error("Unsupported layer compression " + compression_);
+    }
+
+    // The data and compression members of a tile layer with these gids
+    inline std::string layerData(const std::string& encoding_, const std::vector<uint32_t>& gids_)
+    {
+        if (encoding_ == "csv") {
+            std::string text = "\"data\":[";
+            for (size_t i = 0; i < gids_.size(); ++i) {
+                if (i > 0) text += ',';
+                text += std::to_string(gids_[i]);
+            }
+            return text + "]";
+        }
+        std::vector<uint8_t> bytes;
+        bytes.reserve(gids_.size() * 4);
+        for (auto gid : gids_) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                bytes.push_back((uint8_t)(gid >> shift));
+            }
+        }
+        std::string text = "\"encoding\":\"base64\",";
+        if (encoding_ != "base64") text += "\"compression\":\"" + encoding_ + "\",";
+        return text + "\"data\":\"" + encodeBase64(compress(encoding_, bytes)) + "\"";
+    }
+
+    // A finite map with a tile layer of every name, gids are 1 + the tile id like Tiled writes them
+    inline std::string map(const std::string& encoding_, int width_, int height_,
+        const std::vector<std::pair<std::string, std::vector<uint32_t>>>& layers_)
+    {
+        std::string size = "\"width\":" + std::to_string(width_) + ",\"height\":" + std::to_string(height_);
+        std::string text = "{" + size + ",\"tilewidth\":64,\"tileheight\":64,\"infinite\":false,"
+            "\"orientation\":\"orthogonal\",\"renderorder\":\"right-down\",\"type\":\"map\",\"version\":\"1.10\","
+            "\"tiledversion\":\"1.10.2\",\"nextlayerid\":" + std::to_string(layers_.size() + 1) + ",\"nextobjectid\":1,"
+            "\"tilesets\":[],\"layers\":[";
+        int id = 1;
+        for (auto& layer : layers_) {
+            if (id > 1) text += ",";
+            text += "{\"id\":" + std::to_string(id++) + ",\"name\":\"" + layer.first + "\",\"type\":\"tilelayer\","
+                "\"visible\":true,\"opacity\":1,\"x\":0,\"y\":0," + size + "," + layerData(encoding_, layer.second) + "}";
+        }
+        return text + "]}";
+    }
+
+    inline void write(const std::string& path_, const std::string& text_)
+    {
+        std::ofstream(path_, std::ios::binary) << text_;
+    }
+}
+
+#endif //RENEGADE_ENGINE_LAYERENCODING_H
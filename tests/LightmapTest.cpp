@@ -0,0 +1,119 @@
+// Checks that dynamic lights in Lightmap are rebuilt from the baked light instead of piling up, exits
+// with 1 on the first failure
+#include "../src/Lightmap.h"
+#include "TestWorld.h"
+
+using namespace TestWorld;
+
+namespace
+{
+    struct Tiles
+    {
+        World world;
+
+        [[nodiscard]] bool isSolid(int index_) const
+        {
+            return world.isBlocked({ index_ % world.size.x, index_ / world.size.x });
+        }
+
+        [[nodiscard]] int ceiling(int) const
+        {
+            return 0;
+        }
+    };
+
+    bool sameSamples(const Lightmap& a_, const Lightmap& b_)
+    {
+        for (int i = 0; i < a_.getSampleWidth() * a_.getSampleHeight(); ++i) {
+            auto a = a_.getSample(i);
+            auto b = b_.getSample(i);
+            if (a.r != b.r || a.g != b.g || a.b != b.b) {
+                return false;
+            }
+        }
+        for (int i = 0; i < a_.getWidth() * a_.getHeight(); ++i) {
+            if (a_.getIntensity(i) != b_.getIntensity(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Tiles room()
+    {
+        Tiles tiles { World(32, 32) };
+        for (int i = 0; i < 32; ++i) {
+            tiles.world.setBlocked(i, 0, true);
+            tiles.world.setBlocked(i, 31, true);
+            tiles.world.setBlocked(0, i, true);
+            tiles.world.setBlocked(31, i, true);
+        }
+        for (int y = 8; y < 20; ++y) {
+            tiles.world.setBlocked(12, y, true);
+        }
+        return tiles;
+    }
+
+    void sameLightTwice(int subdivision_)
+    {
+        auto tiles = room();
+        Lightmap once(32, 32, 0, subdivision_);
+        Lightmap twice(32, 32, 0, subdivision_);
+        LightColor red { 255, 64, 32 };
+        once.bakeLight(5 * 32 + 5, 128, Light::WHITE_LIGHT, tiles);
+        twice.bakeLight(5 * 32 + 5, 128, Light::WHITE_LIGHT, tiles);
+
+        once.setLight(10 * 32 + 10, 128, red, tiles);
+        twice.setLight(10 * 32 + 10, 128, red, tiles);
+        twice.setLight(10 * 32 + 10, 128, red, tiles);
+        check(sameSamples(once, twice), "same light set twice, subdivision " + std::to_string(subdivision_));
+    }
+
+    // A flicker light going on and off ends where it started
+    void flicker()
+    {
+        auto tiles = room();
+        Lightmap steady(32, 32, 0, 2);
+        Lightmap flickering(32, 32, 0, 2);
+        LightColor blue { 32, 64, 255 };
+        for (auto lightmap : { &steady, &flickering }) {
+            lightmap->bakeLight(20 * 32 + 20, 128, Light::WHITE_LIGHT, tiles);
+            lightmap->setLight(14 * 32 + 14, 128, blue, tiles);
+            lightmap->setLight(16 * 32 + 15, 128, Light::WHITE_LIGHT, tiles);
+        }
+        for (int tick = 0; tick < 20; ++tick) {
+            flickering.setLight(14 * 32 + 14, tick % 3 == 0 ? -128 : (tick % 3) * 64, blue, tiles);
+        }
+        flickering.setLight(14 * 32 + 14, 128, blue, tiles);
+        check(sameSamples(steady, flickering), "flicker light back on its first value");
+    }
+
+    // Dynamic lights stay out of the baked light that is cached with the level
+    void bakedStaysStatic()
+    {
+        auto tiles = room();
+        Lightmap lightmap(32, 32, 0, 2);
+        lightmap.bakeLight(5 * 32 + 5, 128, Light::WHITE_LIGHT, tiles);
+        auto intensity = lightmap.getIntensities();
+        auto samples = lightmap.getSamples();
+        lightmap.setLight(6 * 32 + 6, 128, Light::WHITE_LIGHT, tiles);
+        check(lightmap.getIntensities() == intensity, "baked intensity without the dynamic light");
+        bool sameBaked = true;
+        for (size_t i = 0; i < samples.size(); ++i) {
+            auto a = samples[i];
+            auto b = lightmap.getSamples()[i];
+            sameBaked = sameBaked && a.r == b.r && a.g == b.g && a.b == b.b;
+        }
+        check(sameBaked, "baked samples without the dynamic light");
+        check(lightmap.getIntensity(6 * 32 + 6) != intensity[6 * 32 + 6], "dynamic light is drawn");
+    }
+}
+
+int main()
+{
+    sameLightTwice(1);
+    sameLightTwice(3);
+    flicker();
+    bakedStaysStatic();
+    return result();
+}
@@ -0,0 +1,74 @@
+// Times A* against Jump Point Search on generated worlds, both with the octagonal heuristic.
+// Not a ctest check, run path-benchmark from a release build.
+#include "../lib/AStar/AStar.hpp"
+#include "TestWorld.h"
+#include <chrono>
+
+using namespace TestWorld;
+
+namespace
+{
+    constexpr int QUERIES = 200;
+
+    // Mean microseconds per query, and the summed path cost to compare the modes by
+    double run(const World& world_, const std::vector<std::pair<AStar::Vec2i, AStar::Vec2i>>& queries_,
+        bool jumpPointSearch_, AStar::uint& cost_)
+    {
+        AStar::Generator generator;
+        generator.setWorldSize(world_.size);
+        generator.setDiagonalMovement(true);
+        generator.setHeuristic(AStar::Heuristic::octagonal);
+        generator.setJumpPointSearch(jumpPointSearch_);
+        generator.setCollisionGrid(world_.grid());
+        cost_ = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (auto& query : queries_) {
+            cost_ += pathCost(generator.findPath(query.first, query.second));
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / (double)queries_.size();
+    }
+
+    // Random pairs of tiles A* can walk between
+    std::vector<std::pair<AStar::Vec2i, AStar::Vec2i>> reachablePairs(World& world_, std::mt19937& random_)
+    {
+        AStar::Generator generator;
+        generator.setWorldSize(world_.size);
+        generator.setDiagonalMovement(true);
+        generator.setHeuristic(AStar::Heuristic::octagonal);
+        generator.setCollisionGrid(world_.grid());
+        std::vector<std::pair<AStar::Vec2i, AStar::Vec2i>> pairs;
+        for (int attempt = 0; attempt < QUERIES * 20 && (int)pairs.size() < QUERIES; ++attempt) {
+            AStar::Vec2i source = { (int)(random_() % world_.size.x), (int)(random_() % world_.size.y) };
+            AStar::Vec2i target = { (int)(random_() % world_.size.x), (int)(random_() % world_.size.y) };
+            if (world_.isBlocked(source) || world_.isBlocked(target)) {
+                continue;
+            }
+            if (AStar::Vec2i(generator.findPath(source, target).front()) == target) {
+                pairs.emplace_back(source, target);
+            }
+        }
+        return pairs;
+    }
+
+    void benchmark(const std::string& name_, World world_, std::mt19937& random_)
+    {
+        auto queries = reachablePairs(world_, random_);
+        AStar::uint aStarCost, jpsCost;
+        double aStar = run(world_, queries, false, aStarCost);
+        double jps = run(world_, queries, true, jpsCost);
+        std::printf("%-20s A* %9.1f us   JPS %9.1f us   %s\n", name_.c_str(), aStar, jps,
+            aStarCost == jpsCost ? "same cost" : "COST DIFFERS");
+    }
+}
+
+int main()
+{
+    std::mt19937 random(1);
+    benchmark("noise 256x256 20%", noise(256, 256, 20, random), random);
+    benchmark("noise 1000x1000 30%", noise(1000, 1000, 30, random), random);
+    benchmark("maze 128x128", maze(129, 129, random), random);
+    benchmark("maze 512x512", maze(513, 513, random), random);
+    benchmark("open 1024x1024", World(1024, 1024), random);
+    return 0;
+}
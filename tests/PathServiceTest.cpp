@@ -0,0 +1,146 @@
+// Checks that PathService answers identical requests with one search, searches higher priorities first
+// and routes long requests through the hierarchy, exits with 1 on the first failure
+#include "../src/PathService.h"
+#include "TestWorld.h"
+
+using namespace TestWorld;
+
+namespace
+{
+    bool isReady(const shared_future<AStar::CoordinateList>& future_)
+    {
+        return future_.wait_for(chrono::seconds(0)) == future_status::ready;
+    }
+
+    void fill(SolidGrid& solid_, const World& world_)
+    {
+        for (int y = 0; y < world_.size.y; ++y) {
+            for (int x = 0; x < world_.size.x; ++x) {
+                solid_.set(x, y, world_.isBlocked({ x, y }));
+            }
+        }
+    }
+
+    // Requests for the same path while it waits share one job and so one result
+    void sharedResults()
+    {
+        std::mt19937 random(67);
+        World world = noise(60, 40, 20, random);
+        AStar::Vec2i source = world.randomFreeTile(random);
+        AStar::Vec2i target = world.randomFreeTile(random);
+        SolidGrid solid(world.size.x, world.size.y);
+        fill(solid, world);
+        PathService paths(solid, 2);
+        paths.pause();
+        auto first = paths.request(source, target);
+        auto second = paths.request(source, target, 3);
+        check(paths.getWaitingCount() == 1, "identical requests are not answered together");
+        auto straight = paths.request(source, target, 0, { false, false });
+        check(paths.getWaitingCount() == 2, "requests with other options are answered together");
+        paths.resume();
+        check(&first.get() == &second.get(), "identical requests got separate results");
+        check(&first.get() != &straight.get(), "requests with other options got the same result");
+        check(isPath(world, first.get(), source, AStar::Vec2i(first.get().front())), "shared path is not walkable");
+
+        AStar::Generator generator;
+        generator.setWorldSize(world.size);
+        generator.setDiagonalMovement(true);
+        generator.setHeuristic(AStar::Heuristic::octagonal);
+        generator.setCollisionGrid(world.grid());
+        auto expected = generator.findPath(source, target);
+        check(AStar::Vec2i(first.get().front()) == AStar::Vec2i(expected.front()), "shared path does not end where A*'s does");
+        if (AStar::Vec2i(expected.front()) == target) {
+            check(pathCost(first.get()) == pathCost(expected), "shared path is not optimal");
+        }
+
+        // once answered, the same request is searched again
+        auto again = paths.request(source, target);
+        check(&again.get() != &first.get(), "answered request was reused");
+        check(paths.getWaitingCount() == 0, "requests still waiting after they were answered");
+    }
+
+    // One worker takes the waiting requests by priority, a duplicate with a higher priority moves its job
+    // up. Whenever a request is answered, all of higher priority must be as well. The target is walled
+    // in, so every search goes through the whole map and the next one can't finish before the check.
+    void priorities()
+    {
+        World world(1024, 1024);
+        for (int i = 0; i < 3; ++i) {
+            world.setBlocked(500 + i, 499, true);
+            world.setBlocked(500 + i, 501, true);
+        }
+        world.setBlocked(500, 500, true);
+        world.setBlocked(502, 500, true);
+        SolidGrid solid(world.size.x, world.size.y);
+        fill(solid, world);
+        PathService paths(solid, 1);
+        paths.pause();
+        AStar::Vec2i target = { 501, 500 };
+        // A* without jump points, which would cross the open map too fast
+        PathOptions plain { true, false };
+        auto raised = paths.request({ 1, 1 }, target, 0, plain);
+        auto lowest = paths.request({ 2, 2 }, target, 1, plain);
+        auto low = paths.request({ 3, 3 }, target, 2, plain);
+        auto high = paths.request({ 4, 4 }, target, 5, plain);
+        auto raisedAgain = paths.request({ 1, 1 }, target, 9, plain);
+        check(paths.getWaitingCount() == 4, "raising a priority added a request");
+        paths.resume();
+        high.wait();
+        check(isReady(raised), "priority 5 answered before the raised 9");
+        check(!isReady(lowest), "priority 1 answered before 5");
+        low.wait();
+        check(isReady(raised) && isReady(high), "priority 2 answered before 5 and 9");
+        lowest.wait();
+        check(isReady(raised) && isReady(high) && isReady(low), "lowest priority answered before the others");
+        check(&raised.get() == &raisedAgain.get(), "raised request got a separate result");
+        check(paths.getWaitingCount() == 0, "requests still waiting after they were answered");
+    }
+
+    // Requests beyond the hierarchy range get walkable, nearly shortest paths, also after walls changed
+    void routes()
+    {
+        std::mt19937 random(71);
+        World world = noise(200, 150, 20, random);
+        SolidGrid solid(world.size.x, world.size.y);
+        fill(solid, world);
+        PathService paths(solid, 1);
+        PathOptions routed;
+        routed.hierarchyRange = 32;
+
+        AStar::Generator generator;
+        generator.setWorldSize(world.size);
+        generator.setDiagonalMovement(true);
+        generator.setHeuristic(AStar::Heuristic::octagonal);
+        generator.setCollisionGrid(world.grid());
+        for (int round = 0; round < 20; ++round) {
+            // walls change between the requests, the worker's hierarchy has to follow them
+            for (int i = 0; i < 40; ++i) {
+                int x = (int)(random() % world.size.x);
+                int y = (int)(random() % world.size.y);
+                bool blocked = random() % 100 < 20;
+                world.setBlocked(x, y, blocked);
+                solid.set(x, y, blocked);
+            }
+            AStar::Vec2i source = world.randomFreeTile(random);
+            solid.set(source.x, source.y, false);
+            AStar::Vec2i target = world.randomFreeTile(random);
+            solid.set(target.x, target.y, false);
+            auto path = paths.request(source, target, 0, routed).get();
+            auto expected = generator.findPath(source, target);
+            std::string where = " in round " + std::to_string(round);
+            check(AStar::Vec2i(path.front()) == AStar::Vec2i(expected.front()), "routed path does not end where A*'s does" + where);
+            check(isPath(world, path, source, AStar::Vec2i(path.front())), "routed path is not walkable" + where);
+            if (AStar::Vec2i(expected.front()) == target) {
+                check(pathCost(path) <= pathCost(expected) * 12 / 10, "routed path is much longer than A*'s" + where);
+            }
+        }
+    }
+}
+
+int main()
+{
+    sharedResults();
+    priorities();
+    routes();
+    return result();
+}
@@ -0,0 +1,160 @@
+// Checks that the Moving Target D* Lite replanner finds paths of the same cost as A* while the target
+// moves, the agent walks and walls change, exits with 1 on the first failure
+#include "../lib/AStar/AStar.hpp"
+#include "../lib/AStar/Replanner.hpp"
+#include "TestWorld.h"
+
+using namespace TestWorld;
+
+namespace
+{
+    struct Chase
+    {
+        World world;
+        AStar::Generator aStar;
+        AStar::Replanner replanner;
+        std::string name;
+
+        Chase(World world_, const std::string& name_) : world(std::move(world_)), name(name_)
+        {
+            aStar.setWorldSize(world.size);
+            aStar.setDiagonalMovement(true);
+            aStar.setHeuristic(AStar::Heuristic::octagonal);
+            aStar.setCollisionGrid(world.grid());
+            replanner.setWorldSize(world.size);
+            replanner.setCollisionGrid(world.grid());
+        }
+
+        // The replanner's path, checked against A*
+        AStar::CoordinateList compare(AStar::Vec2i source_, AStar::Vec2i target_, const std::string& step_)
+        {
+            std::string what = name + " " + step_;
+            auto expected = aStar.findPath(source_, target_);
+            auto path = replanner.findPath(source_, target_);
+            bool reachable = AStar::Vec2i(expected.front()) == target_;
+            bool reached = AStar::Vec2i(path.front()) == target_;
+            check(reachable == reached, what + ": A* and the replanner disagree on reachability");
+            if (!reached) {
+                check(path.size() == 1 && AStar::Vec2i(path.front()) == source_, what + ": unreachable path is not the source");
+                return path;
+            }
+            if (!reachable) {
+                return path;
+            }
+            check(isPath(world, path, source_, target_), what + ": path is not walkable");
+            check(pathCost(path) == pathCost(expected), what + ": path costs " + std::to_string(pathCost(path))
+                + ", A* " + std::to_string(pathCost(expected)));
+            return path;
+        }
+
+        void toggleWall(AStar::Vec2i tile_)
+        {
+            world.setBlocked(tile_.x, tile_.y, !world.isBlocked(tile_));
+            replanner.invalidate(tile_);
+        }
+
+        // A random tile, cleared if it was a wall
+        AStar::Vec2i freeTile(std::mt19937& random_)
+        {
+            AStar::Vec2i tile = { (int)(random_() % world.size.x), (int)(random_() % world.size.y) };
+            if (world.isBlocked(tile)) {
+                toggleWall(tile);
+            }
+            return tile;
+        }
+    };
+
+    AStar::Vec2i freeNeighbor(const World& world_, AStar::Vec2i tile_, std::mt19937& random_)
+    {
+        for (int attempt = 0; attempt < 8; ++attempt) {
+            AStar::Vec2i next = { tile_.x + (int)(random_() % 3) - 1, tile_.y + (int)(random_() % 3) - 1 };
+            if (!world_.isBlocked(next)) {
+                return next;
+            }
+        }
+        return tile_;
+    }
+
+    // The target wanders, the agent follows its path one tile per step and walls come and go. Now and
+    // then the agent is put somewhere off its path, or the target jumps.
+    void chase(World world_, int steps_, std::mt19937& random_, const std::string& name_)
+    {
+        Chase chase(std::move(world_), name_);
+        AStar::Vec2i agent = chase.freeTile(random_);
+        AStar::Vec2i target = chase.freeTile(random_);
+        for (int step = 0; step < steps_; ++step) {
+            auto path = chase.compare(agent, target, "step " + std::to_string(step));
+            int event = (int)(random_() % 20);
+            if (event == 0) {
+                agent = chase.freeTile(random_);
+            } else if (event == 1) {
+                target = chase.freeTile(random_);
+            } else if (path.size() > 1) {
+                agent = path[path.size() - 2];
+            }
+            if (event != 1) {
+                target = freeNeighbor(chase.world, target, random_);
+            }
+            int walls = (int)(random_() % 3);
+            for (int i = 0; i < walls; ++i) {
+                AStar::Vec2i tile = { (int)(random_() % chase.world.size.x), (int)(random_() % chase.world.size.y) };
+                if (!(tile == agent) && !(tile == target)) {
+                    chase.toggleWall(tile);
+                }
+            }
+            // walls right on the path, where the repair has the most to do
+            if (event == 2 && path.size() > 4) {
+                AStar::Vec2i tile = path[path.size() / 2];
+                if (!(tile == agent) && !(tile == target)) {
+                    chase.toggleWall(tile);
+                }
+            }
+        }
+    }
+
+    // The chaser reaches the target and stands on it
+    void caught()
+    {
+        Chase chase(World(20, 20), "caught");
+        chase.compare({ 3, 3 }, { 3, 3 }, "on the target");
+        chase.compare({ 3, 3 }, { 4, 4 }, "next to the target");
+        chase.compare({ 4, 4 }, { 4, 4 }, "walked onto the target");
+    }
+
+    // A wall that closes off the target and opens again
+    void enclosed()
+    {
+        World world(30, 30);
+        Chase chase(std::move(world), "enclosed");
+        chase.compare({ 2, 2 }, { 20, 20 }, "open");
+        for (int y = 18; y <= 22; ++y) {
+            for (int x = 18; x <= 22; ++x) {
+                if (x == 18 || x == 22 || y == 18 || y == 22) {
+                    chase.toggleWall({ x, y });
+                }
+            }
+        }
+        chase.compare({ 2, 2 }, { 20, 20 }, "walled in");
+        chase.compare({ 3, 3 }, { 20, 20 }, "walled in, agent moved");
+        chase.toggleWall({ 22, 20 });
+        chase.compare({ 3, 3 }, { 20, 20 }, "opened again");
+    }
+
+    void randomChases()
+    {
+        std::mt19937 random(31);
+        for (int round = 0; round < 12; ++round) {
+            World world = noise(40 + round * 5, 30 + round * 3, 15 + round % 4 * 5, random);
+            chase(std::move(world), 150, random, "noise " + std::to_string(round));
+        }
+        chase(maze(65, 65, random), 200, random, "maze");
+    }
+}
+
+int main()
+{
+    caught();
+    enclosed();
+    randomChases();
+    return result();
+}
@@ -0,0 +1,120 @@
+// Checks the row and rectangle queries of SolidGrid and the DistanceField built on them, exits with 1
+// on the first failure
+#include "../src/SolidGrid.h"
+#include "../src/DistanceField.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition_, const std::string& what_)
+    {
+        if (!condition_) {
+            std::printf("FAILED: %s\n", what_.c_str());
+            failures++;
+        }
+    }
+
+    int referenceFindSolid(const SolidGrid& grid_, int y_, int x0_, int x1_)
+    {
+        for (int x = x0_; x < x1_; ++x) {
+            if (grid_.isSolid(x, y_)) {
+                return x;
+            }
+        }
+        return x1_;
+    }
+
+    // Everything outside the grid is solid, ranges reaching past it are never empty
+    void outOfBounds()
+    {
+        SolidGrid grid(70, 3);
+        check(grid.findSolid(1, -1, 10) == -1, "tile left of the grid is solid");
+        check(!grid.isRowEmpty(1, -1, 10), "row starting left of the grid is not empty");
+        check(!grid.isRowEmpty(1, 60, 71), "row ending right of the grid is not empty");
+        check(grid.findSolid(1, 60, 71) == 70, "first tile right of the grid is the hit");
+        check(grid.findSolid(1, 75, 80) == 75, "row right of the grid starts solid");
+        check(!grid.isRowEmpty(-1, 0, 10), "row above the grid is not empty");
+        check(!grid.isRowEmpty(3, 0, 10), "row below the grid is not empty");
+        check(grid.isRowEmpty(1, 0, 70), "free row inside the grid is empty");
+        check(grid.isRowEmpty(1, 5, 5), "empty range is empty");
+        check(!grid.isRectEmpty(-1, 0, 5, 3), "rect reaching left of the grid is not empty");
+        check(grid.isRectEmpty(0, 0, 70, 3), "free grid is empty");
+    }
+
+    // setBits across a word boundary, then every query against isSolid
+    void randomRows()
+    {
+        std::mt19937 random(7);
+        SolidGrid grid(150, 20);
+        for (int y = 0; y < 20; ++y) {
+            for (int x = -10; x < 160; x += 37) {
+                uint64_t bits = ((uint64_t)random() << 32) | random();
+                bits &= (uint64_t)random() | ((uint64_t)random() << 32);
+                grid.setBits(x, y, bits, 37);
+            }
+        }
+        for (int query = 0; query < 2000; ++query) {
+            int y = (int)(random() % 24) - 2;
+            int x0 = (int)(random() % 170) - 10;
+            int x1 = x0 + (int)(random() % 90);
+            std::string name = "row " + std::to_string(y) + " [" + std::to_string(x0) + ", " + std::to_string(x1) + ")";
+            check(grid.findSolid(y, x0, x1) == referenceFindSolid(grid, y, x0, x1), name + ": findSolid");
+            check(grid.isRowEmpty(y, x0, x1) == (referenceFindSolid(grid, y, x0, x1) == x1), name + ": isRowEmpty");
+        }
+    }
+
+    int referenceDistance(const SolidGrid& grid_, int x_, int y_)
+    {
+        for (int d = 0; d < DistanceField::MAX_DISTANCE; ++d) {
+            for (int y = y_ - d; y <= y_ + d; ++y) {
+                for (int x = x_ - d; x <= x_ + d; ++x) {
+                    if (grid_.isSolid(x, y)) {
+                        return d;
+                    }
+                }
+            }
+        }
+        return DistanceField::MAX_DISTANCE;
+    }
+
+    void distances()
+    {
+        std::mt19937 random(11);
+        SolidGrid grid(90, 40);
+        for (int i = 0; i < 60; ++i) {
+            grid.set((int)(random() % 90), (int)(random() % 40), true);
+        }
+        DistanceField field(grid);
+        for (int y = 0; y < 40; ++y) {
+            for (int x = 0; x < 90; ++x) {
+                check(field.distance(x, y) == referenceDistance(grid, x, y),
+                    "distance at " + std::to_string(x) + ", " + std::to_string(y));
+            }
+        }
+        grid.setRange(20, 10, 80, true);
+        field.update(10, 20, 80, 21);
+        for (int y = 0; y < 40; ++y) {
+            for (int x = 0; x < 90; ++x) {
+                check(field.distance(x, y) == referenceDistance(grid, x, y),
+                    "distance after a wall at " + std::to_string(x) + ", " + std::to_string(y));
+            }
+        }
+    }
+}
+
+int main()
+{
+    outOfBounds();
+    randomRows();
+    distances();
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
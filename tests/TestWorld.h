@@ -0,0 +1,149 @@
+// Helpers shared by the path finding checks and benchmarks
+#ifndef RENEGADE_ENGINE_TESTWORLD_H
+#define RENEGADE_ENGINE_TESTWORLD_H
+
+#include "../lib/AStar/AStar.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace TestWorld
+{
+    // Bit per tile occupancy grid in the layout of AStar::CollisionGrid
+    struct World
+    {
+        AStar::Vec2i size;
+        int rowWords;
+        std::vector<uint64_t> words;
+
+        World(int width_, int height_)
+        {
+            size = { width_, height_ };
+            rowWords = (width_ + 63) / 64;
+            words.assign((size_t)rowWords * height_, 0);
+        }
+
+        void setBlocked(int x_, int y_, bool blocked_)
+        {
+            uint64_t bit = 1ull << (x_ & 63);
+            uint64_t& word = words[(size_t)y_ * rowWords + (x_ >> 6)];
+            word = blocked_ ? word | bit : word & ~bit;
+        }
+
+        bool isBlocked(AStar::Vec2i tile_) const
+        {
+            if (tile_.x < 0 || tile_.y < 0 || tile_.x >= size.x || tile_.y >= size.y) {
+                return true;
+            }
+            return (words[(size_t)tile_.y * rowWords + (tile_.x >> 6)] >> (tile_.x & 63)) & 1;
+        }
+
+        AStar::CollisionGrid grid() const
+        {
+            return { words.data(), rowWords };
+        }
+
+        AStar::Vec2i randomFreeTile(std::mt19937& random_)
+        {
+            AStar::Vec2i tile = { (int)(random_() % size.x), (int)(random_() % size.y) };
+            setBlocked(tile.x, tile.y, false);
+            return tile;
+        }
+    };
+
+    // density_ percent of the tiles blocked
+    inline World noise(int width_, int height_, int density_, std::mt19937& random_)
+    {
+        World world(width_, height_);
+        for (int y = 0; y < height_; ++y) {
+            for (int x = 0; x < width_; ++x) {
+                world.setBlocked(x, y, (int)(random_() % 100) < density_);
+            }
+        }
+        return world;
+    }
+
+    // Corridors one tile wide on the odd tiles, carved by a depth first walk
+    inline World maze(int width_, int height_, std::mt19937& random_)
+    {
+        World world(width_, height_);
+        for (int y = 0; y < height_; ++y) {
+            for (int x = 0; x < width_; ++x) {
+                world.setBlocked(x, y, true);
+            }
+        }
+        std::vector<AStar::Vec2i> stack = { { 1, 1 } };
+        world.setBlocked(1, 1, false);
+        const AStar::Vec2i steps[] = { { 2, 0 }, { -2, 0 }, { 0, 2 }, { 0, -2 } };
+        while (!stack.empty()) {
+            AStar::Vec2i current = stack.back();
+            AStar::Vec2i options[4];
+            int count = 0;
+            for (auto step : steps) {
+                AStar::Vec2i next = { current.x + step.x, current.y + step.y };
+                if (next.x > 0 && next.y > 0 && next.x < width_ - 1 && next.y < height_ - 1 && world.isBlocked(next)) {
+                    options[count++] = next;
+                }
+            }
+            if (count == 0) {
+                stack.pop_back();
+                continue;
+            }
+            AStar::Vec2i next = options[random_() % count];
+            world.setBlocked((current.x + next.x) / 2, (current.y + next.y) / 2, false);
+            world.setBlocked(next.x, next.y, false);
+            stack.push_back(next);
+        }
+        return world;
+    }
+
+    // Target first like Generator::findPath, 8 connected steps onto free tiles
+    inline bool isPath(const World& world_, const AStar::CoordinateList& path_, AStar::Vec2i source_, AStar::Vec2i target_)
+    {
+        if (path_.empty() || !(AStar::Vec2i(path_.front()) == target_) || !(AStar::Vec2i(path_.back()) == source_)) {
+            return false;
+        }
+        for (size_t i = 1; i < path_.size(); ++i) {
+            int dx = std::abs(path_[i].x - path_[i - 1].x);
+            int dy = std::abs(path_[i].y - path_[i - 1].y);
+            if (dx > 1 || dy > 1 || dx + dy == 0 || world_.isBlocked(path_[i - 1])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Octile cost of the steps of a path, 10 straight and 14 diagonal like the generator
+    inline AStar::uint pathCost(const AStar::CoordinateList& path_)
+    {
+        AStar::uint cost = 0;
+        for (size_t i = 1; i < path_.size(); ++i) {
+            bool diagonal = path_[i].x != path_[i - 1].x && path_[i].y != path_[i - 1].y;
+            cost += diagonal ? 14 : 10;
+        }
+        return cost;
+    }
+
+    inline int failures = 0;
+
+    inline void check(bool condition_, const std::string& what_)
+    {
+        if (!condition_) {
+            std::printf("FAILED: %s\n", what_.c_str());
+            failures++;
+        }
+    }
+
+    inline int result()
+    {
+        if (failures > 0) {
+            std::printf("%d checks failed\n", failures);
+            return 1;
+        }
+        return 0;
+    }
+}
+
+#endif //RENEGADE_ENGINE_TESTWORLD_H
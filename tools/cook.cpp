@@ -0,0 +1,47 @@
+#include <iostream>
+#include <string>
+#include "../config.hpp"
+#include "../src/Level.h"
+#include "../src/Map.h"
+#include "../src/LightBake.h"
+#include "../src/CookedLevel.h"
+#include "../src/CsvLevel.h"
+
+using namespace std;
+
+template<class Source>
+size_t cook(Source &level, const string &outputPath) {
+    if (level.isInfinite()) throw runtime_error("Infinite maps are streamed and can't be cooked");
+    auto size = level.getSize();
+    auto objects = level.getObjects();
+    Map map(size.x, size.y, 0, Config::LIGHTMAP_SUBDIVISION);
+    map.loadLayers(level);
+    LightBake::bake(map, objects);
+    return CookedLevel::write(outputPath, map, objects, level.getInputPaths());
+}
+
+// renegade-cook <level.json | level_walls.csv> [output]
+// Converts a Tiled level into the engine's binary level format, including its baked static lighting.
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        cout << "Usage: renegade-cook <level.json | level_walls.csv> [output]" << endl;
+        return 1;
+    }
+    string levelPath = argv[1];
+    string outputPath = argc > 2 ? argv[2] : CookedLevel::cookedPath(levelPath);
+    try {
+        size_t written;
+        if (CsvLevel::isCsvLevel(levelPath)) {
+            CsvLevel level(levelPath);
+            written = cook(level, outputPath);
+        } else {
+            Level level(levelPath);
+            written = cook(level, outputPath);
+        }
+        cout << levelPath << " -> " << outputPath << " (" << written << " bytes)" << endl;
+    } catch (exception &e) {
+        cout << "ERROR: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}